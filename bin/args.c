@@ -87,6 +87,32 @@ args_encoding( int argc, char *argv[], int i, int *charset,
 	}
 }
 
+/* args_jobs()
+ *
+ * Handle "-j N"/"--jobs N", the number of threads used to convert references.
+ */
+void
+args_jobs( int argc, char *argv[], int i, param *p )
+{
+	char *end;
+	long n;
+
+	if ( i+1 >= argc ) {
+		fprintf( stderr, "%s: error -j (--jobs) takes the argument of "
+				"the number of threads\n", p->progname );
+		exit( EXIT_FAILURE );
+	}
+
+	n = strtol( argv[i+1], &end, 10 );
+	if ( end==argv[i+1] || *end!='\0' || n < 1 || n > 1024 ) {
+		fprintf( stderr, "%s: error -j (--jobs) needs a number of "
+				"threads from 1 to 1024, not '%s'\n", p->progname, argv[i+1] );
+		exit( EXIT_FAILURE );
+	}
+
+	p->nthreads = ( int ) n;
+}
+
 /* Must process charset info first so switches are order independent */
 void
 process_charsets( int *argc, char *argv[], param *p )
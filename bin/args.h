@@ -13,5 +13,6 @@ void  args_tellversion( const char *progname );
 int   args_match( const char *check, const char *shortarg, const char *longarg );
 char *args_next( int argc, char *argv[], int n, const char *progname, const char *shortarg, const char *longarg );
 void  process_charsets( int *argc, char *argv[], param *p );
+void  args_jobs( int argc, char *argv[], int i, param *p );
 
 #endif
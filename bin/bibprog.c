@@ -10,6 +10,37 @@
 #include "bibutils.h"
 #include "bibprog.h"
 
+static void
+bibprog_stream( int argc, char *argv[], param *p )
+{
+	bibl_stream s;
+	FILE *fp;
+	int err, i;
+
+	err = bibl_initstream( &s, stdout, p );
+	if ( err ) {
+		bibl_reporterr( err );
+		return;
+	}
+	if ( argc<2 ) {
+		err = bibl_readstream( &s, stdin, "stdin" );
+		if ( err ) bibl_reporterr( err );
+	} else {
+		for ( i=1; i<argc; ++i ) {
+			fp = fopen( argv[i], "r" );
+			if ( fp ) {
+				err = bibl_readstream( &s, fp, argv[i] );
+				if ( err ) bibl_reporterr( err );
+				fclose( fp );
+			}
+		}
+	}
+	bibl_freestream( &s );
+	fflush( stdout );
+	if( p->progname ) fprintf( stderr, "%s: ", p->progname );
+	fprintf( stderr, "Processed %ld references.\n", s.nrefs );
+}
+
 void
 bibprog( int argc, char *argv[], param *p )
 {
@@ -17,6 +48,11 @@ bibprog( int argc, char *argv[], param *p )
 	bibl b;
 	int err, i;
 
+	if ( p->stream && bibl_canstream( p ) ) {
+		bibprog_stream( argc, argv, p );
+		return;
+	}
+
 	bibl_init( &b );
 	if ( argc<2 ) {
 		err = bibl_read( &b, stdin, "stdin", p );
@@ -37,4 +73,3 @@ bibprog( int argc, char *argv[], param *p )
 	fprintf( stderr, "Processed %ld references.\n", b.n );
 	bibl_free( &b );
 }
-
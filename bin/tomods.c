@@ -30,6 +30,9 @@ args_tomods_help( char *progname, char *help1, char *help2 )
 	fprintf(stderr,"  -v, --version             display version\n");
 	fprintf(stderr,"  -a, --add-refcount        add \"_#\", where # is reference count to reference\n");
 	fprintf(stderr,"  -s, --single-refperfile   one reference per output file\n");
+	fprintf(stderr,"  --stream                  convert references one at a time\n");
+	fprintf(stderr,"  -j, --jobs N              convert references using N threads\n");
+	fprintf(stderr,"                            (warnings may then print out of order)\n");
 	fprintf(stderr,"  -i, --input-encoding      input character encoding\n");
 	fprintf(stderr,"  -o, --output-encoding     output character encoding\n");
 	fprintf(stderr,"  -u, --unicode-characters  DEFAULT: write unicode (not xml entities)\n");
@@ -90,6 +93,12 @@ tomods_processargs( int *argc, char *argv[], param *p,
 		} else if ( args_match( argv[i], "-s", "--single-refperfile" )){
 			p->singlerefperfile = 1;
 			subtract = 1;
+		} else if ( args_match( argv[i], NULL, "--stream" ) ) {
+			p->stream = 1;
+			subtract = 1;
+		} else if ( args_match( argv[i], "-j", "--jobs" ) ) {
+			args_jobs( *argc, argv, i, p );
+			subtract = 2;
 		} else if ( args_match( argv[i], "-u", "--unicode-characters")){
 			p->utf8out = 1;
 			p->utf8bom = 1;
@@ -27,6 +27,9 @@ help( char *progname )
 	fprintf(stderr,"  -v, --version            display version\n");
 	fprintf(stderr,"  -nb, --no-bom            do not write Byte Order Mark in UTF8 output\n");
 	fprintf(stderr,"  -s, --single-refperfile  one reference per output file\n");
+	fprintf(stderr,"  --stream                 convert references one at a time\n");
+	fprintf(stderr,"  -j, --jobs N             convert references using N threads\n");
+	fprintf(stderr,"                           (warnings may then print out of order)\n");
 	fprintf(stderr,"  --verbose                for verbose output\n");
 	fprintf(stderr,"  --debug                  for debug output\n");
 
@@ -49,6 +52,12 @@ process_args( int *argc, char *argv[], param *p )
 		} else if ( args_match( argv[i], "-s", "--single-refperfile")){
 			p->singlerefperfile = 1;
 			subtract = 1;
+		} else if ( args_match( argv[i], NULL, "--stream" ) ) {
+			p->stream = 1;
+			subtract = 1;
+		} else if ( args_match( argv[i], "-j", "--jobs" ) ) {
+			args_jobs( *argc, argv, i, p );
+			subtract = 2;
 		} else if ( args_match( argv[i], "-nb", "--no-bom" ) ) {
 			p->utf8bom = 0;
 			subtract = 1;
@@ -38,6 +38,9 @@ help( char *progname )
 	fprintf(stderr,"  -nb, --no-bom             do not write Byte Order Mark in UTF8 output\n");
 	fprintf(stderr,"  -U,  --uppercase          write biblatex tags/types in upper case\n" );
 	fprintf(stderr,"  -s,  --single-refperfile  one reference per output file\n");
+	fprintf(stderr,"  --stream                  convert references one at a time\n");
+	fprintf(stderr,"  -j, --jobs N              convert references using N threads\n");
+	fprintf(stderr,"                            (warnings may then print out of order)\n");
 	fprintf(stderr,"  -i, --input-encoding      interpret input file with requested character set\n" );
 	fprintf(stderr,"                            (use argument for current list)\n");
 	fprintf(stderr,"  -o, --output-encoding     write output file with requested character set\n" );
@@ -69,6 +72,12 @@ process_args( int *argc, char *argv[], param *p )
 		} else if ( args_match( argv[i], "-s", "--single-refperfile" )){
 			p->singlerefperfile = 1;
 			subtract = 1;
+		} else if ( args_match( argv[i], NULL, "--stream" ) ) {
+			p->stream = 1;
+			subtract = 1;
+		} else if ( args_match( argv[i], "-j", "--jobs" ) ) {
+			args_jobs( *argc, argv, i, p );
+			subtract = 2;
 		} else if ( args_match( argv[i], "-sd", "--singledash" ) ) {
 			p->format_opts |= BIBL_FORMAT_BIBOUT_SINGLEDASH;
 			subtract = 1;
@@ -15,6 +15,7 @@
 #include "utf8.h"
 #include "str.h"
 #include "strsearch.h"
+#include "strhash.h"
 #include "fields.h"
 #include "generic.h"
 #include "name.h"
@@ -22,6 +23,7 @@
 #include "type.h"
 #include "url.h"
 #include "bibformats.h"
+#include "once.h"
 
 /*****************************************************
  PUBLIC: int adsout_initparams()
@@ -44,6 +46,8 @@ adsout_initparams( param *pm, const char *progname )
 	pm->nosplittitle     = 0;
 	pm->verbose          = 0;
 	pm->addcount         = 0;
+	pm->stream           = 0;
+	pm->nthreads         = 0;
 	pm->singlerefperfile = 0;
 
 	if ( pm->charsetout == BIBL_CHARSET_UNICODE ) {
@@ -454,19 +458,56 @@ get_firstinitial( fields *in )
 	} else return '\0';
 }
 
+/* Open-addressed hash of journal names (journals[j]+6), case-folded,
+ * holding j+1 with zero for an empty slot.  Only the first of
+ * several entries with the same name is entered, so lookups return the
+ * same entry as a scan of journals[] in order.  Built once, on first use.
+ */
+#define JOURNAL_HASHSIZE (8192)
+
+static unsigned short journal_hash[ JOURNAL_HASHSIZE ];
+
+static unsigned int
+journal_hashname( const char *p )
+{
+	return strhash_hash( p, STRHASH_NOCASE ) & ( JOURNAL_HASHSIZE - 1 );
+}
+
+static void
+journal_hash_build( void )
+{
+	unsigned int h;
+	int j;
+
+	for ( j=0; j<njournals; ++j ) {
+		h = journal_hashname( journals[j]+6 );
+		while ( journal_hash[h] ) {
+			if ( !strcasecmp( journals[ journal_hash[h]-1 ]+6, journals[j]+6 ) ) break;
+			h = ( h + 1 ) & ( JOURNAL_HASHSIZE - 1 );
+		}
+		if ( !journal_hash[h] ) journal_hash[h] = j + 1;
+	}
+}
+
+static bibl_once_t journal_hash_once = BIBL_ONCE_INIT;
+
 static int
 get_journalabbr( fields *in )
 {
+	unsigned int h;
 	char *jrnl;
 	int n, j;
 
 	n = fields_find( in, "TITLE", LEVEL_HOST );
-	if ( n!=FIELDS_NOTFOUND ) {
-		jrnl = fields_value( in, n, FIELDS_CHRP );
-		for ( j=0; j<njournals; j++ ) {
-			if ( !strcasecmp( jrnl, journals[j]+6 ) )
-				return j;
-		}
+	if ( n==FIELDS_NOTFOUND ) return -1;
+
+	bibl_once( &journal_hash_once, journal_hash_build );
+
+	jrnl = fields_value( in, n, FIELDS_CHRP );
+	h = journal_hashname( jrnl );
+	while ( ( j = journal_hash[h] ) ) {
+		if ( !strcasecmp( jrnl, journals[j-1]+6 ) ) return j-1;
+		h = ( h + 1 ) & ( JOURNAL_HASHSIZE - 1 );
 	}
 	return -1;
 }
@@ -672,6 +713,5 @@ adsout_write( fields *out, FILE *fp, param *p, unsigned long refnum )
 	}
 
 	fprintf( fp, "\n" );
-	fflush( fp );
 	return BIBL_OK;
 }
@@ -8,6 +8,9 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#ifndef BIBL_NOTHREADS
+#include <pthread.h>
+#endif
 #include "bibutils.h"
 
 /* internal includes */
@@ -20,6 +23,9 @@
 #define BIBL_INTERNALIN   (BIBL_LASTIN+1)
 #define BIBL_INTERNALOUT  (BIBL_LASTOUT+1)
 
+/* size of the chunks readf pulls from the input with fgets() */
+#define BIBL_READBUFSIZE  (16384)
+
 #define debug_set( p ) ( (p)->verbose > 1 )
 #define verbose_set( p ) ( (p)->verbose )
 
@@ -107,6 +113,9 @@ bibl_duplicateparams( param *np, param *op )
 	status = slist_copy( &(np->corps), &(op->corps ) );
 	if ( status!=SLIST_OK ) return BIBL_ERR_MEMERR;
 
+	np->macros = op->macros;
+	if ( np->macros ) np->macros->nshared++;
+
 	if ( !op->progname ) np->progname = NULL;
 	else {
 		np->progname = strdup( op->progname );
@@ -134,6 +143,8 @@ bibl_duplicateparams( param *np, param *op )
 	np->addcount         = op->addcount;
 	np->output_raw       = op->output_raw;
 	np->singlerefperfile = op->singlerefperfile;
+	np->stream           = op->stream;
+	np->nthreads         = op->nthreads;
 
 	np->readf     = op->readf;
 	np->processf  = op->processf;
@@ -197,10 +208,73 @@ bibl_freeparams( param *p )
 	if ( p ) {
 		slist_free( &(p->asis) );
 		slist_free( &(p->corps) );
+		if ( p->macros && --(p->macros->nshared)==0 ) {
+			strhash_free( &(p->macros->names) );
+			slist_free( &(p->macros->values) );
+			free( p->macros );
+		}
+		p->macros = NULL;
 		if ( p->progname ) free( p->progname );
 	}
 }
 
+bibl_macros *
+bibl_macros_new( void )
+{
+	bibl_macros *m;
+
+	m = ( bibl_macros * ) malloc( sizeof( bibl_macros ) );
+	if ( !m ) return NULL;
+
+	strhash_init( &(m->names), STRHASH_CASE );
+	slist_init( &(m->values) );
+	m->nshared = 1;
+
+	return m;
+}
+
+/* bibl_macros_find()
+ *
+ * Returns the value of macro name, or NULL if it is not defined.
+ */
+str *
+bibl_macros_find( bibl_macros *m, const char *name )
+{
+	int n;
+
+	if ( !m ) return NULL;
+
+	n = strhash_find( &(m->names), name );
+	if ( n==STRHASH_NOTFOUND || n>=m->values.n ) return NULL;
+
+	return slist_str( &(m->values), n );
+}
+
+/* bibl_macros_set()
+ *
+ * Defines macro name, replacing any earlier definition.
+ *
+ * Returns BIBL_OK or BIBL_ERR_MEMERR
+ */
+int
+bibl_macros_set( bibl_macros *m, const char *name, const char *value )
+{
+	int n, status;
+
+	status = strhash_add( &(m->names), name, &n );
+	if ( status!=STRHASH_OK ) return BIBL_ERR_MEMERR;
+
+	/* a failed earlier call can leave names ahead of values */
+	while ( m->values.n <= n ) {
+		status = slist_addc( &(m->values), "" );
+		if ( status!=SLIST_OK ) return BIBL_ERR_MEMERR;
+	}
+
+	if ( !slist_setc( &(m->values), n, value ) ) return BIBL_ERR_MEMERR;
+
+	return BIBL_OK;
+}
+
 int
 bibl_readasis( param *p, char *f )
 {
@@ -443,12 +517,28 @@ out:
 	return ret;
 }
 
+/* update_charsetin()
+ *
+ * charset from file takes priority over default, but
+ * not user-specified
+ */
+static void
+update_charsetin( param *p, int fcharset )
+{
+	if ( fcharset==CHARSET_UNKNOWN ) return;
+	if ( p->charsetin_src==BIBL_SRC_USER ) return;
+
+	p->charsetin_src = BIBL_SRC_FILE;
+	p->charsetin = fcharset;
+	if ( fcharset!=CHARSET_UNICODE ) p->utf8in = 0;
+}
+
 static int
 read_refs( FILE *fp, bibl *bin, char *filename, param *p )
 {
 	int refnum = 0, bufpos = 0, ret=BIBL_OK, fcharset;/* = CHARSET_UNKNOWN;*/
 	str reference, line;
-	char buf[256]="";
+	char buf[BIBL_READBUFSIZE]="";
 	fields *ref;
 
 	str_init( &reference );
@@ -473,15 +563,7 @@ read_refs( FILE *fp, bibl *bin, char *filename, param *p )
 			fields_delete( ref );
 		}
 		str_empty( &reference );
-		if ( fcharset!=CHARSET_UNKNOWN ) {
-			/* charset from file takes priority over default, but
-			 * not user-specified */
-			if ( p->charsetin_src!=BIBL_SRC_USER ) {
-				p->charsetin_src = BIBL_SRC_FILE;
-				p->charsetin = fcharset;
-				if ( fcharset!=CHARSET_UNICODE ) p->utf8in = 0;
-			}
-		}
+		update_charsetin( p, fcharset );
 	}
 	if ( p->charsetin==CHARSET_UNICODE ) p->utf8in = 1;
 out:
@@ -501,6 +583,128 @@ bibl_notexify( char *tag )
 	return 0;
 }
 
+/*
+ * bibl_eachref()
+ *
+ * Run f on every reference in b (bibl_eachref_range() on those in
+ * [start,end)).  References are independent once read
+ * and cleaned, so with p->nthreads > 1 they are handed out in blocks to
+ * a pool of threads; results must be stored per reference by f so that
+ * callers can put them back together in input order.  Returns BIBL_OK
+ * or the error from the earliest failing reference.
+ */
+typedef int (*bibl_reff)( bibl *b, long n, void *data, param *p );
+
+#define BIBL_EACHREF_BLOCK (32)
+
+#ifndef BIBL_NOTHREADS
+typedef struct bibl_eachref_job {
+	bibl      *b;
+	bibl_reff  f;
+	void      *data;
+	param     *p;
+	long       next;     /* first reference not yet handed out */
+	long       failed;   /* earliest failing reference, or end */
+	int        status;
+	pthread_mutex_t lock;
+} bibl_eachref_job;
+
+static void *
+bibl_eachref_worker( void *arg )
+{
+	bibl_eachref_job *job = ( bibl_eachref_job * ) arg;
+	long i, start, end;
+	int status;
+
+	while ( 1 ) {
+
+		pthread_mutex_lock( &(job->lock) );
+		start = job->next;
+		if ( start > job->failed ) start = job->failed;
+		end = start + BIBL_EACHREF_BLOCK;
+		if ( end > job->failed ) end = job->failed;
+		job->next = end;
+		pthread_mutex_unlock( &(job->lock) );
+
+		if ( start >= end ) break;
+
+		for ( i=start; i<end; ++i ) {
+			status = job->f( job->b, i, job->data, job->p );
+			if ( status==BIBL_OK ) continue;
+			pthread_mutex_lock( &(job->lock) );
+			if ( i < job->failed ) {
+				job->failed = i;
+				job->status = status;
+			}
+			pthread_mutex_unlock( &(job->lock) );
+			break;
+		}
+	}
+
+	return NULL;
+}
+#endif
+
+static int
+bibl_eachref_range( bibl *b, long start, long end, bibl_reff f, void *data, param *p )
+{
+	int status;
+	long i;
+#ifndef BIBL_NOTHREADS
+	bibl_eachref_job job;
+	pthread_t *threads;
+	long nthreads;
+	int nstarted;
+
+	nthreads = p->nthreads;
+	if ( nthreads > ( end - start + BIBL_EACHREF_BLOCK - 1 ) / BIBL_EACHREF_BLOCK )
+		nthreads = ( end - start + BIBL_EACHREF_BLOCK - 1 ) / BIBL_EACHREF_BLOCK;
+
+	if ( nthreads > 1 ) {
+
+		threads = ( pthread_t * ) malloc( sizeof( pthread_t ) * nthreads );
+		if ( !threads ) return BIBL_ERR_MEMERR;
+
+		job.b      = b;
+		job.f      = f;
+		job.data   = data;
+		job.p      = p;
+		job.next   = start;
+		job.failed = end;
+		job.status = BIBL_OK;
+		pthread_mutex_init( &(job.lock), NULL );
+
+		for ( nstarted=0; nstarted<nthreads; ++nstarted ) {
+			if ( pthread_create( &(threads[nstarted]), NULL, bibl_eachref_worker, &job ) ) break;
+		}
+
+		/* if no threads could be started, do the work here */
+		if ( nstarted==0 ) bibl_eachref_worker( &job );
+
+		for ( i=0; i<nstarted; ++i )
+			pthread_join( threads[i], NULL );
+
+		pthread_mutex_destroy( &(job.lock) );
+		free( threads );
+
+		return job.status;
+	}
+#endif
+
+	for ( i=start; i<end; ++i ) {
+		status = f( b, i, data, p );
+		if ( status!=BIBL_OK ) return status;
+	}
+
+	return BIBL_OK;
+}
+
+static int
+bibl_eachref( bibl *b, bibl_reff f, void *data, param *p )
+{
+	return bibl_eachref_range( b, 0, b->n, f, data, p );
+}
+
 /* bibl_fixcharsetdata()
  *
  * returns BIBL_OK or BIBL_ERR_MEMERR
@@ -541,40 +745,43 @@ bibl_fixcharsetdata( fields *ref, param *p )
  * returns BIBL_OK or BIBL_ERR_MEMERR
  */
 static int
-bibl_fixcharsets( bibl *b, param *p )
+bibl_fixcharsets_ref( bibl *b, long n, void *unused, param *p )
 {
-	int status;
-	long i;
-
-	for ( i=0; i<b->n; ++i ) {
-		status = bibl_fixcharsetdata( b->ref[i], p );
-		if ( status!=BIBL_OK ) return status;
-	}
+	return bibl_fixcharsetdata( b->ref[n], p );
+}
 
-	return BIBL_OK;
+static int
+bibl_fixcharsets( bibl *b, param *p )
+{
+	return bibl_eachref( b, bibl_fixcharsets_ref, NULL, p );
 }
 
 static int
-bibl_addcount( bibl *b )
+bibl_addcount_ref( fields *ref, long nref )
 {
 	char buf[512];
-	fields *ref;
-	long i;
 	int n;
 
-	for ( i=0; i<b->n; ++i ) {
+	n = fields_find( ref, "REFNUM", LEVEL_MAIN );
+	if ( n==FIELDS_NOTFOUND ) return BIBL_OK;
 
-		ref = b->ref[i];
+	sprintf( buf, "_%ld", nref );
+	str_strcatc( fields_value( ref, n, FIELDS_STRP_NOUSE ), buf );
+	if ( str_memerr( fields_value( ref, n, FIELDS_STRP_NOUSE ) ) )
+		return BIBL_ERR_MEMERR;
 
-		n = fields_find( ref, "REFNUM", LEVEL_MAIN );
-		if ( n==FIELDS_NOTFOUND ) continue;
+	return BIBL_OK;
+}
 
-		sprintf( buf, "_%ld", i+1 );
-		str_strcatc( fields_value( ref, n, FIELDS_STRP_NOUSE ), buf );
-		if ( str_memerr( fields_value( ref, n, FIELDS_STRP_NOUSE ) ) ) {
-			return BIBL_ERR_MEMERR;
-		}
+static int
+bibl_addcount( bibl *b )
+{
+	int status;
+	long i;
 
+	for ( i=0; i<b->n; ++i ) {
+		status = bibl_addcount_ref( b->ref[i], i+1 );
+		if ( status!=BIBL_OK ) return status;
 	}
 
 	return BIBL_OK;
@@ -639,10 +846,17 @@ out:
 	return ret;
 }
 
+/* get_citekeys()
+ *
+ * Adds the citekey of each reference to citekeys and records
+ * its position in the hash in group, so references sharing a
+ * citekey share a group.
+ */
 static int
-get_citekeys( bibl *bin, slist *citekeys )
+get_citekeys( bibl *bin, strhash *citekeys, intlist *group )
 {
-	int n, status;
+	int n, g, status;
+	char *key;
 	fields *f;
 	long i;
 
@@ -650,44 +864,43 @@ get_citekeys( bibl *bin, slist *citekeys )
 		f = bin->ref[i];
 		n = fields_find( f, "REFNUM", LEVEL_ANY );
 		if ( n==FIELDS_NOTFOUND ) n = generate_citekey( f, i+1 );
-		if ( n!=FIELDS_NOTFOUND && fields_has_value( f, n ) ) {
-			status = slist_add( citekeys, fields_value( f, n, FIELDS_STRP_NOUSE ) );
-			if ( status!=SLIST_OK ) return BIBL_ERR_MEMERR;
-		} else {
-			status = slist_addc( citekeys, "" );
-			if ( status!=SLIST_OK ) return BIBL_ERR_MEMERR;
-		}
+		if ( n!=FIELDS_NOTFOUND && fields_has_value( f, n ) )
+			key = fields_value( f, n, FIELDS_CHRP_NOUSE );
+		else
+			key = "";
+		status = strhash_add( citekeys, key, &g );
+		if ( status!=STRHASH_OK ) return BIBL_ERR_MEMERR;
+		status = intlist_add( group, g );
+		if ( status!=INTLIST_OK ) return BIBL_ERR_MEMERR;
 	}
 
 	return BIBL_OK;
 }
 
+/* count_duplicates()
+ *
+ * Returns the number of citekeys shared by more than one reference.
+ */
 static int
-identify_duplicates( bibl *b, slist *citekeys, int *dup )
+count_duplicates( intlist *group, intlist *size )
 {
-	int i, j, ndup = 0;
-
-	for ( i=0; i<citekeys->n-1; ++i ) {
-		if ( dup[i]!=-1 ) continue;
-		for ( j=i+1; j<citekeys->n; ++j ) {
-			if ( !strcmp( slist_cstr( citekeys, i ),
-			              slist_cstr( citekeys, j ) ) ) {
-					dup[i] = i;
-					dup[j] = i;
-					ndup++;
-			}
-		}
+	int i, g, ndup = 0;
+
+	for ( i=0; i<group->n; ++i ) {
+		g = intlist_get( group, i );
+		intlist_set( size, g, intlist_get( size, g ) + 1 );
+		if ( intlist_get( size, g )==2 ) ndup++;
 	}
 
 	return ndup;
 }
 
 static int
-build_new_citekey( int nsame, str *old_citekey, str *new_citekey )
+build_new_citekey( int nsame, const char *old_citekey, str *new_citekey )
 {
 	const char abc[]="abcdefghijklmnopqrstuvwxyz";
 
-	str_strcpy( new_citekey, old_citekey );
+	str_strcpyc( new_citekey, old_citekey );
 
 	while ( nsame >= 26 ) {
 		str_addchar( new_citekey, 'a' );
@@ -699,76 +912,80 @@ build_new_citekey( int nsame, str *old_citekey, str *new_citekey )
 	return ( str_memerr( new_citekey ) ) ? BIBL_ERR_MEMERR : BIBL_OK;
 }
 
+/* resolve_duplicates()
+ *
+ * References sharing a citekey get "a", "b", ... suffixes in
+ * reference order.
+ */
 static int
-resolve_duplicates( bibl *b, slist *citekeys, int *dup )
+resolve_duplicates( bibl *b, strhash *citekeys, intlist *group, intlist *size )
 {
-	int nsame, n, i, j, status = BIBL_OK;
+	int n, g, status = BIBL_OK;
 	str new_citekey, *ref_citekey;
+	intlist nsame;
+	long i;
 
 	str_init( &new_citekey );
 
-	for ( i=0; i<citekeys->n; ++i ) {
-
-		if ( dup[i]==-1 ) continue;
-
-		nsame = 0;
-
-		for ( j=i; j<citekeys->n; ++j ) {
+	status = intlist_init_fill( &nsame, strhash_num( citekeys ), 0 );
+	if ( status!=INTLIST_OK ) {
+		status = BIBL_ERR_MEMERR;
+		goto out;
+	}
 
-			if ( dup[j]!=i ) continue;
+	for ( i=0; i<b->n; ++i ) {
 
-			dup[j] = -1;
+		g = intlist_get( group, i );
+		if ( intlist_get( size, g ) < 2 ) continue;
 
-			status = build_new_citekey( nsame, slist_str( citekeys, j ), &new_citekey );
-			if ( status!=BIBL_OK ) goto out;
+		n = fields_find( b->ref[i], "REFNUM", LEVEL_ANY );
+		if ( n==FIELDS_NOTFOUND ) continue;
 
-			n = fields_find( b->ref[j], "REFNUM", LEVEL_ANY );
-			if ( n==FIELDS_NOTFOUND ) continue;
+		status = build_new_citekey( intlist_get( &nsame, g ), strhash_key( citekeys, g ), &new_citekey );
+		if ( status!=BIBL_OK ) goto out;
 
-			ref_citekey = fields_value( b->ref[j], n, FIELDS_STRP_NOUSE );
+		ref_citekey = fields_value( b->ref[i], n, FIELDS_STRP_NOUSE );
 
-			str_strcpy( ref_citekey, &new_citekey );
-			if ( str_memerr( ref_citekey ) ) { status = BIBL_ERR_MEMERR; goto out; }
+		str_strcpy( ref_citekey, &new_citekey );
+		if ( str_memerr( ref_citekey ) ) { status = BIBL_ERR_MEMERR; goto out; }
 
-			nsame++;
-		}
+		intlist_set( &nsame, g, intlist_get( &nsame, g ) + 1 );
 	}
 out:
+	intlist_free( &nsame );
 	str_free( &new_citekey );
 	return status;
 }
 
 static int
-identify_and_resolve_duplicate_citekeys( bibl *b, slist *citekeys )
+uniqueify_citekeys( bibl *bin )
 {
-	int i, *dup, ndup, status=BIBL_OK;
-
-	dup = ( int * ) malloc( sizeof( int ) * citekeys->n );
-	if ( !dup ) return BIBL_ERR_MEMERR;
-	for ( i=0; i<citekeys->n; ++i ) dup[i] = -1;
+	int ndup, status;
+	strhash citekeys;
+	intlist group, size;
 
-	ndup = identify_duplicates( b, citekeys, dup );
+	if ( bin->n==0 ) return BIBL_OK;
 
-	if ( ndup ) status = resolve_duplicates( b, citekeys, dup );
-
-	free( dup );
-	return status;
-}
+	strhash_init( &citekeys, STRHASH_CASE );
+	intlist_init( &group );
+	intlist_init( &size );
 
-static int
-uniqueify_citekeys( bibl *bin )
-{
-	slist citekeys;
-	int status;
+	status = get_citekeys( bin, &citekeys, &group );
+	if ( status!=BIBL_OK ) goto out;
 
-	slist_init( &citekeys );
+	status = intlist_fill( &size, strhash_num( &citekeys ), 0 );
+	if ( status!=INTLIST_OK ) {
+		status = BIBL_ERR_MEMERR;
+		goto out;
+	}
 
-	status = get_citekeys( bin, &citekeys );
-	if ( status!=BIBL_OK ) goto out;
+	ndup = count_duplicates( &group, &size );
 
-	status = identify_and_resolve_duplicate_citekeys( bin, &citekeys );
+	if ( ndup ) status = resolve_duplicates( bin, &citekeys, &group, &size );
 out:
-	slist_free( &citekeys );
+	intlist_free( &size );
+	intlist_free( &group );
+	strhash_free( &citekeys );
 	return status;
 }
 
@@ -779,37 +996,72 @@ clean_refs( bibl *bin, param *p )
 	else return BIBL_OK;
 }
 
-static int 
-convert_refs( bibl *bin, char *fname, bibl *bout, param *p )
+static int
+convert_ref( fields *rin, char *fname, long nref, fields *rout, param *p )
 {
 	int reftype = 0, status;
-	fields *rin, *rout;
-	long i;
 
-	for ( i=0; i<bin->n; ++i ) {
+	if ( p->typef ) reftype = p->typef( rin, fname, nref, p );
 
-		rin = bin->ref[i];
+	status = p->convertf( rin, rout, reftype, p );
+	if ( status!=BIBL_OK ) return status;
 
-		rout = fields_new();
-		if ( !rout ) return BIBL_ERR_MEMERR;
+	if ( p->all ) {
+		status = process_alwaysadd( rout, reftype, p );
+		if ( status!=BIBL_OK ) return status;
+		status = process_defaultadd( rout, reftype, p );
+		if ( status!=BIBL_OK ) return status;
+	}
 
-		if ( p->typef ) reftype = p->typef( rin, fname, i+1, p );
+	return BIBL_OK;
+}
 
-		status = p->convertf( rin, rout, reftype, p );
-		if ( status!=BIBL_OK ) return status;
+typedef struct convert_refs_data {
+	char    *fname;
+	fields **rout;
+} convert_refs_data;
 
-		if ( p->all ) {
-			status = process_alwaysadd( rout, reftype, p );
-			if ( status!=BIBL_OK ) return status;
-			status = process_defaultadd( rout, reftype, p );
-			if ( status!=BIBL_OK ) return status;
-		}
+static int
+convert_refs_ref( bibl *bin, long n, void *data, param *p )
+{
+	convert_refs_data *d = ( convert_refs_data * ) data;
 
-		status = bibl_addref( bout, rout );
-		if ( status!=BIBL_OK ) return status;
+	d->rout[n] = fields_new();
+	if ( !d->rout[n] ) return BIBL_ERR_MEMERR;
+
+	return convert_ref( bin->ref[n], d->fname, n+1, d->rout[n], p );
+}
+
+/* convert_refs()
+ *
+ * References are converted (possibly in parallel) into a separate array
+ * and then added to bout in input order.
+ */
+static int 
+convert_refs( bibl *bin, char *fname, bibl *bout, param *p )
+{
+	convert_refs_data d;
+	int status;
+	long i;
+
+	if ( bin->n==0 ) return BIBL_OK;
+
+	d.fname = fname;
+	d.rout  = ( fields ** ) calloc( bin->n, sizeof( fields * ) );
+	if ( !d.rout ) return BIBL_ERR_MEMERR;
+
+	status = bibl_eachref( bin, convert_refs_ref, &d, p );
+
+	for ( i=0; i<bin->n && status==BIBL_OK; ++i ) {
+		status = bibl_addref( bout, d.rout[i] );
+		if ( status==BIBL_OK ) d.rout[i] = NULL;
 	}
 
-	return BIBL_OK;
+	for ( i=0; i<bin->n; ++i )
+		if ( d.rout[i] ) fields_delete( d.rout[i] );
+	free( d.rout );
+
+	return status;
 }
 
 int
@@ -961,11 +1213,118 @@ bibl_writeeachfp( FILE *fp, bibl *b, param *p )
 	return BIBL_OK;
 }
 
+static int
+write_ref( fields *ref, fields *out, FILE *fp, param *p, long nref )
+{
+	fields *use = ref;
+	int status;
+
+	if ( p->assemblef ) {
+		fields_free( out );
+		status = p->assemblef( ref, out, p, nref );
+		if ( status!=BIBL_OK ) return status;
+		if ( debug_set( p ) ) bibl_verbose_reference( out, "", nref+1 );
+		use = out;
+	}
+
+	return p->writef( use, fp, p, nref );
+}
+
+/*
+ * Buffering each reference needs open_memstream() (POSIX.1-2008);
+ * configure defines BIBL_NOMEMSTREAM where it is missing and references
+ * are then written one at a time.
+ */
+#if !defined( BIBL_NOTHREADS ) && !defined( BIBL_NOMEMSTREAM )
+#define BIBL_WRITE_PARALLEL
+#endif
+
+#ifdef BIBL_WRITE_PARALLEL
+/*
+ * write_refs_parallel()
+ *
+ * Assemble and write references on the thread pool, each into its own
+ * memory buffer, then copy the buffers to fp in reference order.  Work
+ * is done a window at a time to bound the memory held in buffers.  As
+ * when writing directly, output stops after the first reference that
+ * fails, including whatever it wrote.  Only fp is buffered; diagnostics
+ * the writers print to stderr are not kept in reference order.
+ */
+#define BIBL_WRITE_WINDOW (1024)
+
+typedef struct write_refs_data {
+	long    start;
+	char   *buf[BIBL_WRITE_WINDOW];
+	size_t  len[BIBL_WRITE_WINDOW];
+	int     status[BIBL_WRITE_WINDOW];
+} write_refs_data;
+
+static int
+write_refs_ref( bibl *b, long n, void *data, param *p )
+{
+	write_refs_data *d = ( write_refs_data * ) data;
+	long m = n - d->start;
+	fields out;
+	int status;
+	FILE *fp;
+
+	fp = open_memstream( &(d->buf[m]), &(d->len[m]) );
+	if ( !fp ) status = BIBL_ERR_MEMERR;
+	else {
+		fields_init( &out );
+		status = write_ref( b->ref[n], &out, fp, p, n );
+		fields_free( &out );
+		if ( fclose( fp ) && status==BIBL_OK ) status = BIBL_ERR_MEMERR;
+	}
+
+	d->status[m] = status;
+
+	return status;
+}
+
+static int
+write_refs_parallel( FILE *fp, bibl *b, param *p )
+{
+	int status = BIBL_OK;
+	write_refs_data *d;
+	long i, end;
+
+	d = ( write_refs_data * ) malloc( sizeof( write_refs_data ) );
+	if ( !d ) return BIBL_ERR_MEMERR;
+
+	for ( d->start=0; d->start<b->n && status==BIBL_OK; d->start=end ) {
+
+		end = d->start + BIBL_WRITE_WINDOW;
+		if ( end > b->n ) end = b->n;
+
+		for ( i=0; i<end-d->start; ++i ) {
+			d->buf[i]    = NULL;
+			d->len[i]    = 0;
+			d->status[i] = BIBL_OK;
+		}
+
+		status = bibl_eachref_range( b, d->start, end, write_refs_ref, d, p );
+
+		for ( i=0; i<end-d->start; ++i ) {
+			if ( d->buf[i] ) fwrite( d->buf[i], 1, d->len[i], fp );
+			if ( d->status[i]!=BIBL_OK ) break;
+		}
+
+		for ( i=0; i<end-d->start; ++i )
+			if ( d->buf[i] ) free( d->buf[i] );
+	}
+
+	free( d );
+
+	return status;
+}
+#endif
+
 static int
 bibl_writefp( FILE *fp, bibl *b, param *p )
 {
 	int status = BIBL_OK;
-	fields out, *use = &out;
+	fields out;
 	long i;
 
 	fields_init( &out );
@@ -975,20 +1334,14 @@ bibl_writefp( FILE *fp, bibl *b, param *p )
 	}
 
 	if ( p->headerf ) p->headerf( fp, p );
+#ifdef BIBL_WRITE_PARALLEL
+	if ( p->nthreads > 1 && !debug_set( p ) )
+		status = write_refs_parallel( fp, b, p );
+	else
+#endif
 	for ( i=0; i<b->n; ++i ) {
-
-		if ( p->assemblef ) {
-			fields_free( &out );
-			status = p->assemblef( b->ref[i], &out, p, i );
-			if ( status!=BIBL_OK ) break;
-			if ( debug_set( p ) ) bibl_verbose_reference( &out, "", i+1 );
-		} else {
-			use = b->ref[i];
-		}
-
-		status = p->writef( use, fp, p, i );
+		status = write_ref( b->ref[i], &out, fp, p, i );
 		if ( status!=BIBL_OK ) break;
-
 	}
 
 	if ( debug_set( p ) && p->assemblef ) {
@@ -996,6 +1349,8 @@ bibl_writefp( FILE *fp, bibl *b, param *p )
 	}
 
 	if ( p->footerf ) p->footerf( fp );
+	fflush( fp );
+	fields_free( &out );
 	return status;
 }
 
@@ -1032,3 +1387,249 @@ out:
 	bibl_freeparams( &lp );
 	return status;
 }
+
+/* bibl_canstream()
+ *
+ * BibTeX and BibLaTeX resolve crossrefs against the whole file in
+ * cleanf, so they need every reference before any can be converted.
+ */
+int
+bibl_canstream( param *p )
+{
+	if ( !p ) return 0;
+	if ( p->readformat==BIBL_BIBTEXIN ) return 0;
+	if ( p->readformat==BIBL_BIBLATEXIN ) return 0;
+	return 1;
+}
+
+/* bibl_initstream()
+ *
+ * Sets up write parameters and writes the header.
+ *
+ * Returns BIBL_OK, BIBL_ERR_BADINPUT, or BIBL_ERR_MEMERR
+ */
+int
+bibl_initstream( bibl_stream *s, FILE *fp, param *p )
+{
+	int status;
+
+	if ( !s ) return BIBL_ERR_BADINPUT;
+	if ( !p ) return BIBL_ERR_BADINPUT;
+	if ( bibl_illegalinmode( p->readformat ) ) return BIBL_ERR_BADINPUT;
+	if ( bibl_illegaloutmode( p->writeformat ) ) return BIBL_ERR_BADINPUT;
+	if ( !fp && !p->singlerefperfile ) return BIBL_ERR_BADINPUT;
+	if ( !bibl_canstream( p ) ) return BIBL_ERR_BADINPUT;
+
+	status = bibl_setwriteparams( &(s->lp), p );
+	if ( status!=BIBL_OK ) return status;
+
+	s->p     = p;
+	s->fp    = fp;
+	s->nrefs = 0;
+	strhash_init( &(s->citekeys), STRHASH_CASE );
+	intlist_init( &(s->nseen) );
+
+	if ( debug_set( p ) ) report_params( stderr, "bibl_initstream", &(s->lp) );
+
+	if ( !p->singlerefperfile && s->lp.headerf ) s->lp.headerf( fp, &(s->lp) );
+
+	return BIBL_OK;
+}
+
+/* uniqueify_citekey()
+ *
+ * Earlier references have already been written, so unlike
+ * uniqueify_citekeys() the first reference keeps its citekey and
+ * only later duplicates get the "a", "b", ... suffixes.
+ */
+static int
+uniqueify_citekey( fields *f, long nref, strhash *citekeys, intlist *nseen )
+{
+	int n, g, nsame, status = BIBL_OK;
+	str *citekey, new_citekey;
+	char *key = "";
+
+	n = fields_find( f, "REFNUM", LEVEL_ANY );
+	if ( n==FIELDS_NOTFOUND ) n = generate_citekey( f, nref );
+	if ( n!=FIELDS_NOTFOUND && fields_has_value( f, n ) )
+		key = fields_value( f, n, FIELDS_CHRP_NOUSE );
+
+	status = strhash_add( citekeys, key, &g );
+	if ( status!=STRHASH_OK ) return BIBL_ERR_MEMERR;
+
+	if ( g==nseen->n ) {
+		status = intlist_add( nseen, 0 );
+		if ( status!=INTLIST_OK ) return BIBL_ERR_MEMERR;
+	}
+	nsame = intlist_get( nseen, g );
+	intlist_set( nseen, g, nsame + 1 );
+
+	if ( nsame==0 || n==FIELDS_NOTFOUND ) return BIBL_OK;
+
+	str_init( &new_citekey );
+
+	citekey = fields_value( f, n, FIELDS_STRP_NOUSE );
+	status = build_new_citekey( nsame-1, strhash_key( citekeys, g ), &new_citekey );
+	if ( status==BIBL_OK ) {
+		str_strcpy( citekey, &new_citekey );
+		if ( str_memerr( citekey ) ) status = BIBL_ERR_MEMERR;
+	}
+
+	str_free( &new_citekey );
+	return status;
+}
+
+static int
+stream_writeref( bibl_stream *s, fields *ref )
+{
+	param *p = &(s->lp);
+	int status;
+	fields out;
+	FILE *fp;
+
+	status = bibl_fixcharsetdata( ref, p );
+	if ( status!=BIBL_OK ) return status;
+
+	fields_init( &out );
+
+	if ( p->singlerefperfile ) {
+		fp = singlerefname( ref, s->nrefs, p->writeformat );
+		if ( !fp ) return BIBL_ERR_CANTOPEN;
+		if ( p->headerf ) p->headerf( fp, p );
+		status = write_ref( ref, &out, fp, p, s->nrefs );
+		if ( p->footerf ) p->footerf( fp );
+		fclose( fp );
+	} else {
+		status = write_ref( ref, &out, s->fp, p, s->nrefs );
+	}
+
+	fields_free( &out );
+	return status;
+}
+
+/* stream_ref()
+ *
+ * Runs one freshly-processed reference through the same steps as
+ * bibl_read() and bibl_write(): clean, charset conversion, conversion
+ * to the internal format, citekey generation, and output.
+ */
+static int
+stream_ref( bibl_stream *s, fields *ref, char *filename, long nref, param *p )
+{
+	fields *use = ref, *rout = NULL;
+	int status = BIBL_OK;
+	bibl one;
+
+	if ( !p->output_raw && p->cleanf ) {
+		bibl_init( &one );
+		one.n = one.max = 1;
+		one.ref = &ref;
+		status = p->cleanf( &one, p );
+		/* ref is owned by the caller, don't let bibl_free() delete it */
+		one.n = one.max = 0;
+		one.ref = NULL;
+		bibl_free( &one );
+		if ( status!=BIBL_OK ) goto out;
+	}
+
+	if ( ( !p->output_raw ) || ( p->output_raw & BIBL_RAW_WITHCHARCONVERT ) ) {
+		status = bibl_fixcharsetdata( ref, p );
+		if ( status!=BIBL_OK ) goto out;
+	}
+
+	if ( !p->output_raw ) {
+		rout = fields_new();
+		if ( !rout ) { status = BIBL_ERR_MEMERR; goto out; }
+		status = convert_ref( ref, filename, nref, rout, p );
+		if ( status!=BIBL_OK ) goto out;
+		use = rout;
+	}
+
+	if ( ( !p->output_raw ) || ( p->output_raw & BIBL_RAW_WITHMAKEREFID ) ) {
+		status = uniqueify_citekey( use, s->nrefs+1, &(s->citekeys), &(s->nseen) );
+		if ( status!=BIBL_OK ) goto out;
+		if ( p->addcount ) {
+			status = bibl_addcount_ref( use, s->nrefs+1 );
+			if ( status!=BIBL_OK ) goto out;
+		}
+	}
+
+	if ( debug_set( p ) ) bibl_verbose_reference( use, filename, nref );
+
+	status = stream_writeref( s, use );
+	if ( status==BIBL_OK ) s->nrefs++;
+out:
+	if ( rout ) fields_delete( rout );
+	return status;
+}
+
+/* bibl_readstream()
+ *
+ * Reads, converts, and writes each reference in fp before reading
+ * the next one.
+ *
+ * Returns BIBL_OK, BIBL_ERR_BADINPUT, BIBL_ERR_MEMERR, or BIBL_ERR_CANTOPEN
+ */
+int
+bibl_readstream( bibl_stream *s, FILE *fp, char *filename )
+{
+	int bufpos = 0, status = BIBL_OK, fcharset;
+	str reference, line;
+	char buf[BIBL_READBUFSIZE]="";
+	long refnum = 0;
+	fields *ref;
+	param rp;
+
+	if ( !s )  return BIBL_ERR_BADINPUT;
+	if ( !fp ) return BIBL_ERR_BADINPUT;
+
+	status = bibl_setreadparams( &rp, s->p );
+	if ( status!=BIBL_OK ) return status;
+
+	if ( debug_set( &rp ) ) report_params( stderr, "bibl_readstream", &rp );
+
+	str_init( &reference );
+	str_init( &line );
+
+	while ( rp.readf( fp, buf, sizeof(buf), &bufpos, &line, &reference, &fcharset ) ) {
+		if ( reference.len==0 ) continue;
+		ref = fields_new();
+		if ( !ref ) {
+			status = BIBL_ERR_MEMERR;
+			goto out;
+		}
+		if ( rp.processf( ref, reference.data, filename, refnum+1, &rp ) ) {
+			update_charsetin( &rp, fcharset );
+			if ( rp.charsetin==CHARSET_UNICODE ) rp.utf8in = 1;
+			refnum += 1;
+			status = stream_ref( s, ref, filename, refnum, &rp );
+		} else {
+			update_charsetin( &rp, fcharset );
+		}
+		fields_delete( ref );
+		str_empty( &reference );
+		if ( status!=BIBL_OK ) goto out;
+	}
+out:
+	str_free( &line );
+	str_free( &reference );
+	bibl_freeparams( &rp );
+	return status;
+}
+
+/* bibl_freestream()
+ *
+ * Writes the footer and frees the stream.
+ */
+void
+bibl_freestream( bibl_stream *s )
+{
+	if ( !s ) return;
+	if ( !s->lp.singlerefperfile ) {
+		if ( s->lp.footerf ) s->lp.footerf( s->fp );
+		fflush( s->fp );
+	}
+	strhash_free( &(s->citekeys) );
+	intlist_free( &(s->nseen) );
+	bibl_freeparams( &(s->lp) );
+}
@@ -17,6 +17,9 @@ bibl_init( bibl *b )
 {
 	b->n   = b->max = 0L;
 	b->ref = NULL;
+	b->indexed = 0;
+	strhash_init( &(b->citekeys), STRHASH_CASE );
+	intlist_init( &(b->refpos) );
 }
 
 static int
@@ -60,6 +63,7 @@ bibl_addref( bibl *b, fields *ref )
 	if ( status==BIBL_OK ) {
 		b->ref[ b->n ] = ref;
 		b->n++;
+		b->indexed = 0;
 	}
 	return status;
 }
@@ -74,6 +78,9 @@ bibl_free( bibl *b )
 
 	free( b->ref );
 
+	strhash_free( &(b->citekeys) );
+	intlist_free( &(b->refpos) );
+
 	bibl_init( b );
 }
 
@@ -101,7 +108,44 @@ bibl_copy( bibl *bout, bibl *bin )
 	return BIBL_OK;
 }
 
+/* bibl_buildindex()
+ *
+ * Map each citekey to the first reference using it, as the linear
+ * scan in bibl_findref() used to find.
+ */
+static int
+bibl_buildindex( bibl *b )
+{
+	int n, pos, status;
+	long i;
+
+	strhash_empty( &(b->citekeys) );
+	intlist_empty( &(b->refpos) );
+
+	for ( i=0; i<b->n; ++i ) {
+
+		n = fields_find( b->ref[i], "refnum", LEVEL_ANY );
+		if ( n==FIELDS_NOTFOUND ) continue;
+
+		status = strhash_add( &(b->citekeys), fields_value( b->ref[i], n, FIELDS_CHRP_NOUSE ), &pos );
+		if ( status!=STRHASH_OK ) return BIBL_ERR_MEMERR;
+
+		if ( pos==b->refpos.n ) {
+			status = intlist_add( &(b->refpos), i );
+			if ( status!=INTLIST_OK ) return BIBL_ERR_MEMERR;
+		}
+
+	}
+
+	b->indexed = 1;
+
+	return BIBL_OK;
+}
+
 /* bibl_findref()
+ *
+ * The citekey index is built on first use and rebuilt after
+ * references are added; citekeys must not be changed in between.
  *
  * returns position of reference matching citekey, else -1
  */
@@ -111,6 +155,15 @@ bibl_findref( bibl *bin, const char *citekey )
 	long i;
 	int n;
 
+	if ( !bin->indexed ) bibl_buildindex( bin );
+
+	if ( bin->indexed ) {
+		n = strhash_find( &(bin->citekeys), citekey );
+		if ( n==STRHASH_NOTFOUND ) return -1;
+		return intlist_get( &(bin->refpos), n );
+	}
+
+	/* couldn't allocate the index, fall back to a linear scan */
 	for ( i=0; i<bin->n; ++i ) {
 
 		n = fields_find( bin->ref[i], "refnum", LEVEL_ANY );
@@ -13,11 +13,16 @@
 #include "str.h"
 #include "fields.h"
 #include "reftypes.h"
+#include "strhash.h"
+#include "intlist.h"
 
 typedef struct {
 	long n;
 	long max;
 	fields **ref;
+	int indexed;      /* citekeys/refpos are current; cleared by bibl_addref() */
+	strhash citekeys; /* lazily-built index for bibl_findref() */
+	intlist refpos;   /* position of first reference with each citekey */
 } bibl;
 
 void bibl_init( bibl *b );
@@ -21,14 +21,13 @@
 #include "slist.h"
 #include "name.h"
 #include "reftypes.h"
+#include "once.h"
 #include "bibformats.h"
 #include "generic.h"
 
 extern variants biblatex_all[];
 extern int biblatex_nall;
 
-static slist find    = { 0, 0, 0, NULL };
-static slist replace = { 0, 0, 0, NULL };
 
 /*****************************************************
  PUBLIC: void biblatexin_initparams()
@@ -52,6 +51,8 @@ biblatexin_initparams( param *pm, const char *progname )
 	pm->nosplittitle     = 0;
 	pm->verbose          = 0;
 	pm->addcount         = 0;
+	pm->stream           = 0;
+	pm->nthreads         = 0;
 	pm->output_raw       = 0;
 
 	pm->readf    = biblatexin_readf;
@@ -61,10 +62,14 @@ biblatexin_initparams( param *pm, const char *progname )
 	pm->convertf = biblatexin_convertf;
 	pm->all      = biblatex_all;
 	pm->nall     = biblatex_nall;
+	reftypes_index_build( pm->all, pm->nall );
 
 	slist_init( &(pm->asis) );
 	slist_init( &(pm->corps) );
 
+	pm->macros = bibl_macros_new();
+	if ( !pm->macros ) return BIBL_ERR_MEMERR;
+
 	if ( !progname ) pm->progname = NULL;
 	else {
 		pm->progname = strdup( progname );
@@ -266,17 +271,17 @@ outerr:
 static void
 replace_strings( slist *tokens, fields *bibin, long nref, param *pm )
 {
-	int i, n, ok;
+	str *s, *value;
+	int i, ok;
 	char *q;
-	str *s;
 	i = 0;
 	while ( i < tokens->n ) {
 		s = slist_str( tokens, i );
 		if ( !strcmp( s->data, "#" ) ) {
 		} else if ( s->data[0]!='\"' && s->data[0]!='{' ) {
-			n = slist_find( &find, s );
-			if ( n!=-1 ) {
-				str_strcpy( s, slist_str( &replace, n ) );
+			value = bibl_macros_find( pm->macros, str_cstr( s ) );
+			if ( value ) {
+				str_strcpy( s, value );
 			} else {
 				q = s->data;
 				ok = 1;
@@ -426,8 +431,8 @@ out:
 static int
 process_string( const char *p, long nref, param *pm )
 {
-	int n, status = BIBL_OK;
-	str s1, s2, *s;
+	int status = BIBL_OK;
+	str s1, s2;
 	strs_init( &s1, &s2, NULL );
 	while ( *p && *p!='{' && *p!='(' ) p++;
 	if ( *p=='{' || *p=='(' ) p++;
@@ -439,17 +444,7 @@ process_string( const char *p, long nref, param *pm )
 		str_strcpyc( &s2, "" );
 	}
 	if ( str_has_value( &s1 ) ) {
-		n = slist_find( &find, &s1 );
-		if ( n==-1 ) {
-			status = slist_add_ret( &find, &s1, BIBL_OK, BIBL_ERR_MEMERR );
-			if ( status!=BIBL_OK ) goto out;
-			status = slist_add_ret( &replace, &s2, BIBL_OK, BIBL_ERR_MEMERR );
-			if ( status!=BIBL_OK ) goto out;
-		} else {
-			if ( str_has_value( &s2 ) ) s = slist_set( &replace, n, &s2 );
-			else s = slist_setc( &replace, n, "" );
-			if ( s==NULL ) { status = BIBL_ERR_MEMERR; goto out; }
-		}
+		status = bibl_macros_set( pm->macros, str_cstr( &s1 ), str_cstr( &s2 ) );
 	}
 out:
 	strs_free( &s1, &s2, NULL );
@@ -1085,8 +1080,10 @@ static void
 biblatexin_notag( param *p, char *tag )
 {
 	if ( p->verbose && strcmp( tag, "INTERNAL_TYPE" ) ) {
+		bibl_lockwarn();
 		if ( p->progname ) fprintf( stderr, "%s: ", p->progname );
 		fprintf( stderr, " Cannot find tag '%s'\n", tag );
+		bibl_unlockwarn();
 	}
 }
 
@@ -22,12 +22,10 @@
 #include "url.h"
 #include "reftypes.h"
 #include "latex_parse.h"
+#include "once.h"
 #include "bibformats.h"
 #include "generic.h"
 
-static slist find    = { 0, 0, 0, NULL };
-static slist replace = { 0, 0, 0, NULL };
-
 extern variants bibtex_all[];
 extern int bibtex_nall;
 
@@ -53,6 +51,8 @@ bibtexin_initparams( param *pm, const char *progname )
 	pm->nosplittitle     = 0;
 	pm->verbose          = 0;
 	pm->addcount         = 0;
+	pm->stream           = 0;
+	pm->nthreads         = 0;
 	pm->output_raw       = 0;
 
 	pm->readf    = bibtexin_readf;
@@ -62,10 +62,14 @@ bibtexin_initparams( param *pm, const char *progname )
 	pm->convertf = bibtexin_convertf;
 	pm->all      = bibtex_all;
 	pm->nall     = bibtex_nall;
+	reftypes_index_build( pm->all, pm->nall );
 
 	slist_init( &(pm->asis) );
 	slist_init( &(pm->corps) );
 
+	pm->macros = bibl_macros_new();
+	if ( pm->macros==NULL ) return BIBL_ERR_MEMERR;
+
 	if ( !progname ) pm->progname = NULL;
 	else {
 		pm->progname = strdup( progname );
@@ -141,6 +145,7 @@ typedef struct loc {
 	const char *progname;
 	const char *filename;
 	long nref;
+	bibl_macros *macros;
 } loc;
 
 /* process_bibtextype()
@@ -380,10 +385,10 @@ token_is_escaped( str *s )
  * do bibtex string replacement for data tokens
  */
 static int
-replace_strings( slist *tokens )
+replace_strings( slist *tokens, loc *currloc )
 {
-	int i, n;
-	str *s;
+	str *s, *value;
+	int i;
 
 	for ( i=0; i<tokens->n; ++i ) {
 
@@ -395,10 +400,10 @@ replace_strings( slist *tokens )
 		/* ...skip if token is string concatentation symbol */
 		if ( !str_strcmpc( s, "#" ) ) continue;
 
-		n = slist_find( &find, s );
-		if ( slist_wasnotfound( &find, n ) ) continue;
+		value = bibl_macros_find( currloc->macros, str_cstr( s ) );
+		if ( !value ) continue;
 
-		str_strcpy( s, slist_str( &replace, n ) );
+		str_strcpy( s, value );
 		if ( str_memerr( s ) ) return BIBL_ERR_MEMERR;
 
 	}
@@ -517,7 +522,7 @@ process_bibtexline( const char *p, str *tag, str *data, uchar stripquotes, loc *
 	}
 
 	if ( p ) {
-		status = replace_strings( &tokens );
+		status = replace_strings( &tokens, currloc );
 		if ( status!=BIBL_OK ) p = NULL;
 	}
 
@@ -588,8 +593,8 @@ out:
 static int
 process_string( const char *p, loc *currloc )
 {
-	int n, status = BIBL_OK;
-	str s1, s2, *t;
+	int status = BIBL_OK;
+	str s1, s2;
 
 	strs_init( &s1, &s2, NULL );
 
@@ -606,16 +611,7 @@ process_string( const char *p, loc *currloc )
 	}
 
 	if ( str_has_value( &s1 ) ) {
-		n = slist_find( &find, &s1 );
-		if ( n==-1 ) {
-			status = slist_add_ret( &find,    &s1, BIBL_OK, BIBL_ERR_MEMERR );
-			if ( status!=BIBL_OK ) goto out;
-			status = slist_add_ret( &replace, &s2, BIBL_OK, BIBL_ERR_MEMERR );
-			if ( status!=BIBL_OK ) goto out;
-		} else {
-			t = slist_set( &replace, n, &s2 );
-			if ( t==NULL ) { status = BIBL_ERR_MEMERR; goto out; }
-		}
+		status = bibl_macros_set( currloc->macros, str_cstr( &s1 ), str_cstr( &s2 ) );
 	}
 
 out:
@@ -635,6 +631,7 @@ bibtexin_processf( fields *bibin, const char *data, const char *filename, long n
 	currloc.progname = pm->progname;
 	currloc.filename = filename;
 	currloc.nref     = nref;
+	currloc.macros   = pm->macros;
 
 	if ( !strncasecmp( data, "@STRING", 7 ) ) {
 		process_string( data+7, &currloc );
@@ -1328,8 +1325,10 @@ static void
 bibtexin_notag( param *p, char *tag )
 {
 	if ( p->verbose && strcmp( tag, "INTERNAL_TYPE" ) ) {
+		bibl_lockwarn();
 		if ( p->progname ) fprintf( stderr, "%s: ", p->progname );
 		fprintf( stderr, "Cannot find tag '%s'\n", tag );
+		bibl_unlockwarn();
 	}
 }
 
@@ -1376,7 +1375,11 @@ bibtexin_convertf( fields *bibin, fields *bibout, int reftype, param *p )
 		if ( status!=BIBL_OK ) return status;
 	}
 
-	if ( status==BIBL_OK && p->verbose ) fields_report( bibout, stderr );
+	if ( status==BIBL_OK && p->verbose ) {
+		bibl_lockwarn();
+		fields_report( bibout, stderr );
+		bibl_unlockwarn();
+	}
 
 	return status;
 }
@@ -20,6 +20,7 @@
 #include "title.h"
 #include "type.h"
 #include "url.h"
+#include "once.h"
 #include "bibformats.h"
 
 /*****************************************************
@@ -43,6 +44,8 @@ bibtexout_initparams( param *pm, const char *progname )
 	pm->nosplittitle     = 0;
 	pm->verbose          = 0;
 	pm->addcount         = 0;
+	pm->stream           = 0;
+	pm->nthreads         = 0;
 	pm->singlerefperfile = 0;
 
 	pm->headerf   = generic_writeheader;
@@ -139,12 +142,14 @@ bibtexout_type( fields *in, const char *progname, const char *filename, unsigned
 		maxlevel = fields_maxlevel( in );
 		if ( maxlevel > 0 ) type = TYPE_MISC;
 		else {
+			bibl_lockwarn();
 			if ( progname ) fprintf( stderr, "%s: ", progname );
 			fprintf( stderr, "Cannot identify TYPE in reference %lu ", refnum+1 );
 			n = fields_find( in, "REFNUM", LEVEL_ANY );
 			if ( n!=FIELDS_NOTFOUND ) 
 				fprintf( stderr, " %s", (char*) fields_value( in, n, FIELDS_CHRP ) );
 			fprintf( stderr, " (defaulting to @Misc)\n" );
+			bibl_unlockwarn();
 			type = TYPE_MISC;
 		}
 	}
@@ -788,7 +793,7 @@ static int
 bibtexout_write( fields *out, FILE *fp, param *pm, unsigned long refnum )
 {
 	int i, j, len, nquotes, format_opts = pm->format_opts;
-	char *tag, *value, ch;
+	char *tag, *value, *q;
 
 	/* ...output type information "@article{" */
 	value = ( char * ) fields_value( out, 0, FIELDS_CHRP );
@@ -797,7 +802,7 @@ bibtexout_write( fields *out, FILE *fp, param *pm, unsigned long refnum )
 		len = (value) ? strlen( value ) : 0;
 		fprintf( fp, "@" );
 		for ( i=0; i<len; ++i )
-			fprintf( fp, "%c", toupper((unsigned char)value[i]) );
+			fputc( toupper((unsigned char)value[i]), fp );
 		fprintf( fp, "{" );
 	}
 
@@ -816,7 +821,7 @@ bibtexout_write( fields *out, FILE *fp, param *pm, unsigned long refnum )
 		else {
 			len = strlen( tag );
 			for ( i=0; i<len; ++i )
-				fprintf( fp, "%c", toupper((unsigned char)tag[i]) );
+				fputc( toupper((unsigned char)tag[i]), fp );
 		}
 		if ( format_opts & BIBL_FORMAT_BIBOUT_WHITESPACE ) fprintf( fp, " = \t" );
 		else fprintf( fp, "=" );
@@ -826,17 +831,21 @@ bibtexout_write( fields *out, FILE *fp, param *pm, unsigned long refnum )
 
 		len = strlen( value );
 		for ( i=0; i<len; ++i ) {
-			ch = value[i];
-			if ( ch!='\"' ) fprintf( fp, "%c", ch );
+			/* ...copy the run up to the next quote in one write */
+			q = memchr( value+i, '\"', len-i );
+			if ( !q ) {
+				fwrite( value+i, 1, len-i, fp );
+				break;
+			}
+			fwrite( value+i, 1, q-(value+i), fp );
+			i = q - value;
+			if ( format_opts & BIBL_FORMAT_BIBOUT_BRACKETS || ( i>0 && value[i-1]=='\\' ) )
+				fprintf( fp, "\"" );
 			else {
-				if ( format_opts & BIBL_FORMAT_BIBOUT_BRACKETS || ( i>0 && value[i-1]=='\\' ) )
-					fprintf( fp, "\"" );
-				else {
-					if ( nquotes % 2 == 0 )
-						fprintf( fp, "``" );
-					else    fprintf( fp, "\'\'" );
-					nquotes++;
-				}
+				if ( nquotes % 2 == 0 )
+					fprintf( fp, "``" );
+				else    fprintf( fp, "\'\'" );
+				nquotes++;
 			}
 		}
 
@@ -848,7 +857,5 @@ bibtexout_write( fields *out, FILE *fp, param *pm, unsigned long refnum )
 	if ( format_opts & BIBL_FORMAT_BIBOUT_FINALCOMMA ) fprintf( fp, "," );
 	fprintf( fp, "\n}\n\n" );
 
-	fflush( fp );
-
 	return BIBL_OK;
 }
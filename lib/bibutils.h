@@ -17,6 +17,8 @@ extern "C" {
 #include "bibdefs.h"
 #include "bibl.h"
 #include "slist.h"
+#include "strhash.h"
+#include "intlist.h"
 #include "charsets.h"
 #include "str_conv.h"
 
@@ -78,6 +80,19 @@ extern "C" {
 
 typedef unsigned char uchar;
 
+/* bibl_macros
+ *
+ * @STRING macros defined in BibTeX and biblatex input.  Parameters
+ * copied from one another share a table, so a macro defined in one
+ * input file can be used in the next, while each set of parameters
+ * from bibl_initparams() has its own.
+ */
+typedef struct bibl_macros {
+	strhash names;
+	slist   values;  /* value of each name, by its position in names */
+	int     nshared; /* parameter sets using this table */
+} bibl_macros;
+
 typedef struct param {
 
 	int readformat;
@@ -102,9 +117,12 @@ typedef struct param {
 	uchar output_raw;
 	uchar verbose;
 	uchar singlerefperfile;
+	uchar stream;         /* If true, convert one reference at a time */
+	int nthreads;         /* threads converting references, 0 or 1 for none */
 
 	slist asis;  /* Names that shouldn't be mangled */
 	slist corps; /* Names that shouldn't be mangled-MODS corporation type */
+	bibl_macros *macros; /* @STRING macros, NULL if format has none */
 
 	char *progname;
 
@@ -124,8 +142,27 @@ typedef struct param {
 
 } param;
 
+/* bibl_stream
+ *
+ * Converts and writes references one at a time as they are read, so
+ * memory use is bounded by the largest reference rather than the
+ * whole input.  Only the citekeys seen so far are retained so that
+ * later duplicates can still be made unique.
+ */
+typedef struct bibl_stream {
+	param   *p;        /* user parameters, read parameters built per file */
+	param    lp;       /* write parameters */
+	FILE    *fp;
+	long     nrefs;
+	strhash  citekeys;
+	intlist  nseen;    /* references seen so far with each citekey */
+} bibl_stream;
+
 int  bibl_initparams( param *p, int readmode, int writemode, char *progname );
 void bibl_freeparams( param *p );
+bibl_macros *bibl_macros_new( void );
+str *bibl_macros_find( bibl_macros *m, const char *name );
+int  bibl_macros_set( bibl_macros *m, const char *name, const char *value );
 int  bibl_readasis( param *p, char *filename );
 int  bibl_addtoasis( param *p, char *entry );
 int  bibl_readcorps( param *p, char *filename );
@@ -134,6 +171,11 @@ int  bibl_read( bibl *b, FILE *fp, char *filename, param *p );
 int  bibl_write( bibl *b, FILE *fp, param *p );
 void bibl_reporterr( int err );
 
+int  bibl_canstream( param *p );
+int  bibl_initstream( bibl_stream *s, FILE *fp, param *p );
+int  bibl_readstream( bibl_stream *s, FILE *fp, char *filename );
+void bibl_freestream( bibl_stream *s );
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
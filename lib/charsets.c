@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "charsets.h"
+#include "once.h"
 
 #define ARRAYSIZE( a )     ( sizeof(a) / sizeof(a[0]) )
 #define ARRAYSTART( a )    ( &(a[0]) )
@@ -34612,11 +34613,108 @@ charset_lookupchar( int charsetin, char c )
 	return allcharconvert[charsetin].table[uc].unicode;
 }
 
-unsigned int
-charset_lookupuni( int charsetout, unsigned int unicode )
+/* Reverse (Unicode to charset) lookups
+ *
+ * Every table maps Basic Multilingual Plane characters to byte values,
+ * so each charset gets a two-level map: a 256-entry directory indexed
+ * by the high byte of the character, pointing at 256-byte pages indexed
+ * by the low byte.  Pages with no mapped characters all share a page
+ * filled with '?', the value charset_lookupuni() returns for characters
+ * that cannot be represented.  Where a table lists a character more
+ * than once, the first entry wins as it does for the linear search.
+ *
+ * The maps for all charsets are built together on first use, once, so
+ * that threads converting references can share them; charset_isascii()
+ * flags are worked out at the same time.
+ */
+#define CHARSET_NPAGES   ( 256 )
+#define CHARSET_PAGESIZE ( 256 )
+#define CHARSET_MAXUNI   ( CHARSET_NPAGES * CHARSET_PAGESIZE - 1 )
+
+typedef struct charset_reverse_t {
+	unsigned char *page[CHARSET_NPAGES];
+} charset_reverse_t;
+
+static charset_reverse_t *charset_reverse = NULL;
+static void charset_build_ascii( void );
+static unsigned char charset_nopage[CHARSET_PAGESIZE];
+
+static int
+charset_build_reverse_one( charset_reverse_t *r, convert_t *table, int ntable )
+{
+	unsigned int hi;
+	int i;
+
+	for ( i=0; i<CHARSET_NPAGES; ++i )
+		r->page[i] = charset_nopage;
+
+	for ( i=ntable-1; i>=0; --i ) {
+		if ( table[i].unicode > CHARSET_MAXUNI || table[i].index > 255 ) return 0;
+		hi = table[i].unicode / CHARSET_PAGESIZE;
+		if ( r->page[hi]==charset_nopage ) {
+			r->page[hi] = ( unsigned char * ) malloc( CHARSET_PAGESIZE );
+			if ( !r->page[hi] ) { r->page[hi] = charset_nopage; return 0; }
+			memset( r->page[hi], '?', CHARSET_PAGESIZE );
+		}
+		r->page[hi][ table[i].unicode % CHARSET_PAGESIZE ] = ( unsigned char ) table[i].index;
+	}
+
+	return 1;
+}
+
+static void
+charset_free_reverse( charset_reverse_t *r, int n )
+{
+	int i, j;
+
+	for ( i=0; i<n; ++i ) {
+		for ( j=0; j<CHARSET_NPAGES; ++j )
+			if ( r[i].page[j]!=charset_nopage ) free( r[i].page[j] );
+	}
+	free( r );
+}
+
+/* charset_build_reverse()
+ *
+ * On any failure the maps are discarded and lookups fall back to
+ * scanning the tables.
+ */
+static void
+charset_build_reverse( void )
+{
+	charset_reverse_t *r;
+	int i;
+
+	memset( charset_nopage, '?', CHARSET_PAGESIZE );
+
+	charset_build_ascii();
+
+	r = ( charset_reverse_t * ) calloc( nallcharconvert, sizeof( charset_reverse_t ) );
+	if ( !r ) return;
+
+	for ( i=0; i<nallcharconvert; ++i ) {
+		if ( !charset_build_reverse_one( &(r[i]), allcharconvert[i].table, allcharconvert[i].ntable ) ) {
+			charset_free_reverse( r, i+1 );
+			return;
+		}
+	}
+
+	charset_reverse = r;
+}
+
+static bibl_once_t charset_reverse_once = BIBL_ONCE_INIT;
+
+static charset_reverse_t *
+charset_get_reverse( void )
+{
+	bibl_once( &charset_reverse_once, charset_build_reverse );
+	return charset_reverse;
+}
+
+static unsigned int
+charset_scanuni( int charsetout, unsigned int unicode )
 {
 	int i;
-	if ( charsetout==CHARSET_UNICODE ) return unicode;
 	for ( i=0; i<allcharconvert[charsetout].ntable; ++i ) {
 		if ( unicode == allcharconvert[charsetout].table[i].unicode )
 			return allcharconvert[charsetout].table[i].index;
@@ -34624,3 +34722,72 @@ charset_lookupuni( int charsetout, unsigned int unicode )
 	return '?';
 }
 
+unsigned int
+charset_lookupuni( int charsetout, unsigned int unicode )
+{
+	charset_reverse_t *r;
+
+	if ( charsetout==CHARSET_UNICODE ) return unicode;
+
+	r = charset_get_reverse();
+	if ( !r ) return charset_scanuni( charsetout, unicode );
+	if ( unicode > CHARSET_MAXUNI ) return '?';
+
+	return r[charsetout].page[ unicode / CHARSET_PAGESIZE ][ unicode % CHARSET_PAGESIZE ];
+}
+
+/* charset_isascii()
+ *
+ * Return 1 if characters 0x01-0x7F are unchanged on input and output
+ * through charset n, as they are for Unicode, GB18030 and most of the
+ * tables (but not e.g. EBCDIC or the national ISO 646 variants).
+ */
+static unsigned char *charset_ascii = NULL;
+
+static int
+charset_check_ascii( convert_t *table, int ntable )
+{
+	char seen[128];
+	int i;
+
+	if ( ntable < 128 ) return 0;
+
+	for ( i=1; i<128; ++i )
+		if ( table[i].unicode != (unsigned int) i ) return 0;
+
+	/* charset_lookupuni() uses the first entry for each character */
+	memset( seen, 0, sizeof( seen ) );
+	for ( i=0; i<ntable; ++i ) {
+		if ( table[i].unicode >= 128 || seen[ table[i].unicode ] ) continue;
+		seen[ table[i].unicode ] = 1;
+		if ( table[i].index != table[i].unicode ) return 0;
+	}
+	for ( i=1; i<128; ++i )
+		if ( !seen[i] ) return 0;
+
+	return 1;
+}
+
+static void
+charset_build_ascii( void )
+{
+	int i;
+
+	charset_ascii = ( unsigned char * ) malloc( nallcharconvert );
+	if ( !charset_ascii ) return;
+
+	for ( i=0; i<nallcharconvert; ++i )
+		charset_ascii[i] = charset_check_ascii( allcharconvert[i].table, allcharconvert[i].ntable );
+}
+
+int
+charset_isascii( int n )
+{
+	if ( n==CHARSET_UNICODE || n==CHARSET_GB18030 ) return 1;
+	if ( n<0 || n>=nallcharconvert ) return 0;
+
+	charset_get_reverse();
+	if ( !charset_ascii ) return 0;
+
+	return charset_ascii[n];
+}
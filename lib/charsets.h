@@ -21,5 +21,6 @@ extern int charset_find( char *name );
 extern void charset_list_all( FILE *fp );
 extern unsigned int charset_lookupchar( int charsetin, char c );
 extern unsigned int charset_lookupuni( int charsetout, unsigned int unicode );
+extern int charset_isascii( int n );
 
 #endif
@@ -16,6 +16,7 @@
 #include "name.h"
 #include "fields.h"
 #include "reftypes.h"
+#include "once.h"
 #include "bibformats.h"
 #include "generic.h"
 
@@ -42,6 +43,8 @@ copacin_initparams( param *pm, const char *progname )
 	pm->nosplittitle     = 0;
 	pm->verbose          = 0;
 	pm->addcount         = 0;
+	pm->stream           = 0;
+	pm->nthreads         = 0;
 	pm->output_raw       = 0;
 
 	pm->readf    = copacin_readf;
@@ -51,9 +54,11 @@ copacin_initparams( param *pm, const char *progname )
 	pm->convertf = copacin_convertf;
 	pm->all      = copac_all;
 	pm->nall     = copac_nall;
+	reftypes_index_build( pm->all, pm->nall );
 
 	slist_init( &(pm->asis) );
 	slist_init( &(pm->corps) );
+	pm->macros = NULL;
 
 	if ( !progname ) pm->progname = NULL;
 	else {
@@ -274,8 +279,10 @@ static void
 copacin_report_notag( param *p, char *tag )
 {
 	if ( p->verbose ) {
+		bibl_lockwarn();
 		if ( p->progname ) fprintf( stderr, "%s: ", p->progname );
 		fprintf( stderr, "Cannot find tag '%s'\n", tag );
+		bibl_unlockwarn();
 	}
 }
 
@@ -37,6 +37,8 @@ ebiin_initparams( param *pm, const char *progname )
 	pm->nosplittitle     = 0;
 	pm->verbose          = 0;
 	pm->addcount         = 0;
+	pm->stream           = 0;
+	pm->nthreads         = 0;
 	pm->output_raw       = BIBL_RAW_WITHMAKEREFID |
 	                       BIBL_RAW_WITHCHARCONVERT;
 
@@ -50,6 +52,7 @@ ebiin_initparams( param *pm, const char *progname )
 
 	slist_init( &(pm->asis) );
 	slist_init( &(pm->corps) );
+	pm->macros = NULL;
 
 	if ( !progname ) pm->progname = NULL;
 	else {
@@ -66,14 +69,16 @@ ebiin_initparams( param *pm, const char *progname )
 static int
 ebiin_readf( FILE *fp, char *buf, int bufsize, int *bufpos, str *line, str *reference, int *fcharset )
 {
-	int haveref = 0, inref = 0, file_charset = CHARSET_UNKNOWN, m;
+	int haveref = 0, inref = 0, file_charset = CHARSET_UNKNOWN;
+	int sniff = ( *bufpos==0 && buf[0]=='\0' ); /* at start of stream */
 	char *startptr = NULL, *endptr;
+	unsigned long scanned = 0;
 	str tmp;
 	str_init( &tmp );
 	while ( !haveref && str_fget( fp, buf, bufsize, bufpos, line ) ) {
-		if ( line->data ) {
-			m = xml_getencoding( line );
-			if ( m!=CHARSET_UNKNOWN ) file_charset = m;
+		if ( sniff && str_has_value( line ) && *skip_ws( str_cstr( line ) ) ) {
+			file_charset = xml_getencoding( str_cstr( line ) );
+			sniff = 0;
 		}
 		if ( str_has_value( line ) )
 			startptr = xml_find_start( str_cstr( line ), "Publication" );
@@ -83,7 +88,7 @@ ebiin_readf( FILE *fp, char *buf, int bufsize, int *bufpos, str *line, str *refe
 				str_strcatc( &tmp, startptr );
 				inref = 1;
 			}
-			endptr = xml_find_end( str_cstr( &tmp ), "Publication" );
+			endptr = xml_find_end_more( &tmp, "Publication", &scanned );
 			if ( endptr ) {
 				str_segcpy( reference, str_cstr( &tmp ), endptr );
 				haveref = 1;
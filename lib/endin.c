@@ -16,6 +16,7 @@
 #include "fields.h"
 #include "url.h"
 #include "reftypes.h"
+#include "once.h"
 #include "bibformats.h"
 #include "generic.h"
 
@@ -44,6 +45,8 @@ endin_initparams( param *pm, const char *progname )
 	pm->nosplittitle     = 0;
 	pm->verbose          = 0;
 	pm->addcount         = 0;
+	pm->stream           = 0;
+	pm->nthreads         = 0;
 	pm->output_raw       = 0;
 
 	pm->readf    = endin_readf;
@@ -53,9 +56,11 @@ endin_initparams( param *pm, const char *progname )
 	pm->convertf = endin_convertf;
 	pm->all      = end_all;
 	pm->nall     = end_nall;
+	reftypes_index_build( pm->all, pm->nall );
 
 	slist_init( &(pm->asis) );
 	slist_init( &(pm->corps) );
+	pm->macros = NULL;
 
 	if ( !progname ) pm->progname = NULL;
 	else {
@@ -540,8 +545,10 @@ endin_type( fields *bibin, int n, str *intag, str *invalue, int level, param *pm
 		}
 	}
 	if ( !found ) {
+		bibl_lockwarn();
 		fprintf( stderr, "Did not identify reference type '%s'\n", invalue->data );
 		fprintf( stderr, "Defaulting to journal article type\n");
+		bibl_unlockwarn();
 		status = fields_add( bibout, "INTERNAL_TYPE", types[0].newstr, level );
 		if ( status!=FIELDS_OK ) return BIBL_ERR_MEMERR;
 	}
@@ -552,8 +559,10 @@ static void
 endin_notag( param *p, char *tag, char *data )
 {
 	if ( p->verbose ) {
+		bibl_lockwarn();
 		if ( p->progname ) fprintf( stderr, "%s: ", p->progname );
 		fprintf( stderr, "Cannot find tag '%s'='%s'\n", tag, data );
+		bibl_unlockwarn();
 	}
 }
 
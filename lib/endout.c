@@ -19,6 +19,7 @@
 #include "title.h"
 #include "type.h"
 #include "url.h"
+#include "once.h"
 #include "bibformats.h"
 
 /*****************************************************
@@ -42,6 +43,8 @@ endout_initparams( param *pm, const char *progname )
 	pm->nosplittitle     = 0;
 	pm->verbose          = 0;
 	pm->addcount         = 0;
+	pm->stream           = 0;
+	pm->nthreads         = 0;
 	pm->singlerefperfile = 0;
 
 	if ( pm->charsetout == BIBL_CHARSET_UNICODE ) {
@@ -166,10 +169,12 @@ static void
 type_report_progress( param *p, const char *element_type, int type, unsigned long refnum )
 {
 	if ( p->verbose ) {
+		bibl_lockwarn();
 		if ( p->progname ) fprintf( stderr, "%s: ", p->progname );
 		fprintf( stderr, "Type from %s element in reference %lu: ", element_type, refnum+1 );
 		write_type( stderr, type );
 		fprintf( stderr, "\n" );
+		bibl_unlockwarn();
 	}
 }
 
@@ -185,6 +190,7 @@ type_from_default( fields *in, param *p, unsigned long refnum )
 	else type = TYPE_GENERIC;
 
 
+	bibl_lockwarn();
 	if ( p->progname ) fprintf( stderr, "%s: ", p->progname );
 	fprintf( stderr, "Cannot identify TYPE in reference %lu ", refnum+1 );
 	n = fields_find( in, "REFNUM", LEVEL_ANY );
@@ -194,6 +200,7 @@ type_from_default( fields *in, param *p, unsigned long refnum )
 		fprintf( stderr, " (defaulting to book chapter)\n" );
 	else
 		fprintf( stderr, " (defaulting to generic)\n" );
+	bibl_unlockwarn();
 
 	return type;
 }
@@ -404,8 +411,10 @@ append_type( int type, fields *out, param *p, int *status )
 	if ( !found ) {
 		fstatus = fields_add( out, "%0", "Generic", LEVEL_MAIN );
 		if ( fstatus!=FIELDS_OK ) *status = BIBL_ERR_MEMERR;
+		bibl_lockwarn();
 		if ( p->progname ) fprintf( stderr, "%s: ", p->progname );
 		fprintf( stderr, "Cannot identify type %d\n", type );
+		bibl_unlockwarn();
 	}
 }
 
@@ -771,6 +780,5 @@ endout_write( fields *out, FILE *fp, param *pm, unsigned long refnum )
 	}
 
 	fprintf( fp, "\n" );
-	fflush( fp );
 	return BIBL_OK;
 }
@@ -8,6 +8,7 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include "is_ws.h"
 #include "str.h"
 #include "str_conv.h"
 #include "fields.h"
@@ -47,6 +48,8 @@ endxmlin_initparams( param *pm, const char *progname )
 	pm->nosplittitle     = 0;
 	pm->verbose          = 0;
 	pm->addcount         = 0;
+	pm->stream           = 0;
+	pm->nthreads         = 0;
 	pm->output_raw       = 0;
 
 	pm->readf    = endxmlin_readf;
@@ -56,9 +59,11 @@ endxmlin_initparams( param *pm, const char *progname )
 	pm->convertf = endin_convertf;
 	pm->all      = end_all;
 	pm->nall     = end_nall;
+	reftypes_index_build( pm->all, pm->nall );
 
 	slist_init( &(pm->asis) );
 	slist_init( &(pm->corps) );
+	pm->macros = NULL;
 
 	if ( !progname ) pm->progname = NULL;
 	else {
@@ -83,8 +88,10 @@ xml_readmore( FILE *fp, char *buf, int bufsize, int *bufpos )
 static int
 endxmlin_readf( FILE *fp, char *buf, int bufsize, int *bufpos, str *line, str *reference, int *fcharset )
 {
-	int haveref = 0, inref = 0, done = 0, file_charset = CHARSET_UNKNOWN, m;
+	int haveref = 0, inref = 0, done = 0, file_charset = CHARSET_UNKNOWN;
+	int sniff = ( buf[0]=='\0' ); /* at start of stream */
 	char *startptr = NULL, *endptr = NULL;
+	unsigned long scanned = 0;
 	str tmp;
 
 	str_init( &tmp );
@@ -96,12 +103,17 @@ endxmlin_readf( FILE *fp, char *buf, int bufsize, int *bufpos, str *line, str *r
 			str_strcatc( line, buf );
 		}
 
+		if ( sniff && str_has_value( line ) && *skip_ws( str_cstr( line ) ) ) {
+			file_charset = xml_getencoding( str_cstr( line ) );
+			sniff = 0;
+		}
+
 		if ( !inref ) {
 			startptr = xml_find_start( str_cstr( line ), "RECORD" );
 			if ( startptr ) inref = 1;
 		}
 		else {
-			endptr = xml_find_end( str_cstr( line ), "RECORD" );
+			endptr = xml_find_end_more( line, "RECORD", &scanned );
 		}
 
 		/* If no <record> tag, we can trim up to last 8 bytes */
@@ -131,9 +143,6 @@ endxmlin_readf( FILE *fp, char *buf, int bufsize, int *bufpos, str *line, str *r
 			haveref = 1;
 		}
 
-		m = xml_getencoding( line );
-		if ( m!=CHARSET_UNKNOWN ) file_charset = m;
-
 	}
 
 	str_free( &tmp );
@@ -9,7 +9,9 @@
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
+#include "strhash.h"
 #include "entities.h"
+#include "once.h"
 
 /* HTML 4.0 entities */
 
@@ -282,27 +284,79 @@ entities html_entities[] = {
 };
 
 
-static unsigned int
-decode_html_entity( char *s, unsigned int *pi, int *err )
+/*
+ * named entity lookup
+ *
+ * Every html_entities[] name is "&name;", so the only entry that can
+ * match at an '&' is the one whose name, compared without regard to
+ * case, runs up to the next ';'.  Names are hashed case-independently
+ * into an open-addressed table built on first use; where two entries
+ * differ only by case (e.g. "&Agrave;" and "&agrave;") the earlier one
+ * is kept, as the linear search found it first.
+ */
+#define ENTITY_MAXLEN    ( (int) sizeof( ((entities *)0)->html ) )
+#define ENTITY_HASHSIZE  ( 1024 )   /* power of two, > 2 * number of entities */
+
+static short entity_hash[ ENTITY_HASHSIZE ];
+
+static void
+entity_build_hash( void )
 {
 	int nhtml_entities = sizeof( html_entities ) / sizeof( entities );
+	unsigned int h;
+	int i, len;
 	char *e;
-	int i, n=-1, len;
-	for ( i=0; i<nhtml_entities && n==-1; ++i ) {
+
+	for ( h=0; h<ENTITY_HASHSIZE; ++h ) entity_hash[h] = -1;
+
+	for ( i=0; i<nhtml_entities; ++i ) {
 		e = &(html_entities[i].html[0]);
 		len = strlen( e );
-		if ( !strncasecmp( &(s[*pi]), e, len ) ) {
-			n = i;
-			*pi += len;
+		h = strhash_hashn( e, len, STRHASH_NOCASE ) & ( ENTITY_HASHSIZE-1 );
+		while ( entity_hash[h]!=-1 ) {
+			if ( !strcasecmp( html_entities[ entity_hash[h] ].html, e ) ) break;
+			h = ( h+1 ) & ( ENTITY_HASHSIZE-1 );
 		}
+		if ( entity_hash[h]==-1 ) entity_hash[h] = i;
 	}
-	if ( n==-1 ) {
-		*err = 1;
-		return '&';
-	} else {
-		*err = 0;
-		return html_entities[n].unicode;
+}
+
+static bibl_once_t entity_hash_once = BIBL_ONCE_INIT;
+
+static void
+entity_init( void )
+{
+	bibl_once( &entity_hash_once, entity_build_hash );
+}
+
+static unsigned int
+decode_html_entity( char *s, unsigned int *pi, int *err )
+{
+	unsigned int h;
+	char *p = &(s[*pi]);
+	int len, n;
+
+	entity_init();
+
+	/* "&name;" including the delimiters */
+	for ( len=1; len<ENTITY_MAXLEN && p[len] && p[len]!=';'; ++len )
+		;
+	if ( len<ENTITY_MAXLEN-1 && p[len]==';' ) {
+		len++;
+		h = strhash_hashn( p, len, STRHASH_NOCASE ) & ( ENTITY_HASHSIZE-1 );
+		while ( ( n = entity_hash[h] )!=-1 ) {
+			if ( !strncasecmp( p, html_entities[n].html, len ) &&
+			     html_entities[n].html[len]=='\0' ) {
+				*pi += len;
+				*err = 0;
+				return html_entities[n].unicode;
+			}
+			h = ( h+1 ) & ( ENTITY_HASHSIZE-1 );
+		}
 	}
+
+	*err = 1;
+	return '&';
 }
 
 
@@ -10,10 +10,17 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include "intlist.h"
+#include "strhash.h"
 #include "fields.h"
 
 #define FIELDS_MIN_ALLOC (20)
 
+/* Records with at least this many fields get an index over their
+ * tags so that finding a tag doesn't compare against every field.
+ */
+#define FIELDS_INDEX_MIN (16)
+
 /* private helper macros to access fields
  *
  * These skip all of the error checking and used flag manipulation
@@ -42,6 +49,262 @@ fields_init( fields *f )
 	f->used  = f->level = NULL;
 	f->tag   = f->value = NULL;
 	f->max   = f->n     = 0;
+	f->index = NULL;
+	f->arena = NULL;
+}
+
+/*
+ * fields_arena
+ *
+ * Tags are never changed once added, so rather than giving each tag
+ * its own str buffer, their bytes are packed into blocks owned by the
+ * record and the tag strs point into them.  All blocks are released
+ * together by fields_free().
+ */
+#define FIELDS_ARENA_MIN (1024)
+
+struct fields_arena {
+	fields_arena *next;
+	unsigned long size;
+	unsigned long used;
+};
+
+static void
+fields_arena_free( fields *f )
+{
+	fields_arena *a, *next;
+
+	for ( a=f->arena; a; a=next ) {
+		next = a->next;
+		free( a );
+	}
+
+	f->arena = NULL;
+}
+
+static char *
+fields_arena_strdup( fields *f, const char *s, unsigned long len )
+{
+	fields_arena *a = f->arena;
+	unsigned long size;
+	char *p;
+
+	if ( !a || a->size - a->used < len + 1 ) {
+		size = FIELDS_ARENA_MIN;
+		if ( size < len + 1 ) size = len + 1;
+		a = ( fields_arena * ) malloc( sizeof( fields_arena ) + size );
+		if ( !a ) return NULL;
+		a->next  = f->arena;
+		a->size  = size;
+		a->used  = 0;
+		f->arena = a;
+	}
+
+	p = ( char * ) ( a + 1 ) + a->used;
+	memcpy( p, s, len );
+	p[len] = '\0';
+	a->used += len + 1;
+
+	return p;
+}
+
+/*
+ * fields_index
+ *
+ * Each tag is case-folded and hashed once when added.  An open-addressed
+ * table keyed on (tag hash, level) holds the first and last field of a
+ * chain linking every field with that tag and level in order; a second
+ * set of chains keyed on the tag hash alone serves LEVEL_ANY lookups.
+ * Chains may mix tags whose hashes collide, so walkers still compare
+ * the tag itself.
+ */
+typedef struct fields_slot {
+	unsigned int hash;
+	int level;
+	int all;        /* chain covers every level */
+	int head, tail;
+} fields_slot;
+
+struct fields_index {
+	fields_slot *slot;
+	int nslots, nused;
+	unsigned int *hash;
+	int *nextlevel; /* next field with same tag and level */
+	int *nextall;   /* next field with same tag at any level */
+	int max;
+};
+
+static unsigned int
+fields_hashtag( const char *tag )
+{
+	return strhash_hash( tag, STRHASH_NOCASE );
+}
+
+static void
+fields_index_free( fields *f )
+{
+	fields_index *x = f->index;
+
+	if ( !x ) return;
+
+	if ( x->slot )      free( x->slot );
+	if ( x->hash )      free( x->hash );
+	if ( x->nextlevel ) free( x->nextlevel );
+	if ( x->nextall )   free( x->nextall );
+	free( x );
+
+	f->index = NULL;
+}
+
+static fields_slot *
+fields_index_slot( fields_index *x, unsigned int hash, int level, int all )
+{
+	unsigned int mask = x->nslots - 1;
+	unsigned int i = ( hash ^ ( all ? 0x9e3779b9U : ( unsigned int ) level * 0x85ebca6bU ) ) & mask;
+	fields_slot *s;
+
+	while ( 1 ) {
+		s = &(x->slot[i]);
+		if ( s->head==-1 ) return s;
+		if ( s->hash==hash && s->all==all && ( all || s->level==level ) ) return s;
+		i = ( i + 1 ) & mask;
+	}
+}
+
+static int
+fields_index_resize( fields_index *x, int nslots )
+{
+	fields_slot *old = x->slot, *s;
+	int i, nold = x->nslots;
+
+	x->slot = ( fields_slot * ) malloc( sizeof( fields_slot ) * nslots );
+	if ( !x->slot ) {
+		x->slot = old;
+		return FIELDS_ERR_MEMERR;
+	}
+	x->nslots = nslots;
+	for ( i=0; i<nslots; ++i )
+		x->slot[i].head = -1;
+
+	for ( i=0; i<nold; ++i ) {
+		if ( old[i].head==-1 ) continue;
+		s = fields_index_slot( x, old[i].hash, old[i].level, old[i].all );
+		*s = old[i];
+	}
+
+	if ( old ) free( old );
+
+	return FIELDS_OK;
+}
+
+static int
+fields_index_chain( fields_index *x, unsigned int hash, int level, int all, int n, int *next )
+{
+	fields_slot *s;
+	int status;
+
+	if ( 2 * ( x->nused + 1 ) > x->nslots ) {
+		status = fields_index_resize( x, x->nslots * 2 );
+		if ( status!=FIELDS_OK ) return status;
+	}
+
+	s = fields_index_slot( x, hash, level, all );
+	if ( s->head==-1 ) {
+		s->hash  = hash;
+		s->level = level;
+		s->all   = all;
+		s->head  = n;
+		x->nused++;
+	} else {
+		next[ s->tail ] = n;
+	}
+	s->tail = n;
+	next[ n ] = -1;
+
+	return FIELDS_OK;
+}
+
+static int
+fields_index_add( fields *f, int n )
+{
+	fields_index *x = f->index;
+	unsigned int *newhash;
+	int *newlevel, *newall;
+	int status, alloc;
+
+	if ( n >= x->max ) {
+		alloc = ( f->max > n ) ? f->max : n + 1;
+		newhash  = ( unsigned int * ) realloc( x->hash, sizeof( unsigned int ) * alloc );
+		if ( newhash ) x->hash = newhash;
+		newlevel = ( int * ) realloc( x->nextlevel, sizeof( int ) * alloc );
+		if ( newlevel ) x->nextlevel = newlevel;
+		newall   = ( int * ) realloc( x->nextall, sizeof( int ) * alloc );
+		if ( newall ) x->nextall = newall;
+		if ( !newhash || !newlevel || !newall ) return FIELDS_ERR_MEMERR;
+		x->max = alloc;
+	}
+
+	x->hash[n] = fields_hashtag( _fields_tag_char( f, n ) );
+
+	status = fields_index_chain( x, x->hash[n], _fields_level( f, n ), 0, n, x->nextlevel );
+	if ( status!=FIELDS_OK ) return status;
+
+	return fields_index_chain( x, x->hash[n], 0, 1, n, x->nextall );
+}
+
+/* fields_has_index()
+ *
+ * Builds the index the first time a large enough record is searched.
+ * Returns 1 if the index can be used, 0 to fall back to scanning.
+ */
+static int
+fields_has_index( fields *f )
+{
+	int i, status;
+
+	if ( f->index ) return 1;
+	if ( f->n < FIELDS_INDEX_MIN ) return 0;
+
+	f->index = ( fields_index * ) calloc( 1, sizeof( fields_index ) );
+	if ( !f->index ) return 0;
+
+	status = fields_index_resize( f->index, 64 );
+	for ( i=0; i<f->n && status==FIELDS_OK; ++i )
+		status = fields_index_add( f, i );
+
+	if ( status!=FIELDS_OK ) {
+		fields_index_free( f );
+		return 0;
+	}
+
+	return 1;
+}
+
+/* fields_first()/fields_next()
+ *
+ * Walk the fields that could match tag at level; callers still check
+ * each one.  Indexed records visit only the chain for the tag, others
+ * visit every field.  Returns -1 at the end.
+ */
+static int
+fields_first( fields *f, const char *tag, int level )
+{
+	fields_slot *s;
+
+	if ( !fields_has_index( f ) ) return ( f->n > 0 ) ? 0 : -1;
+
+	if ( level==LEVEL_ANY ) s = fields_index_slot( f->index, fields_hashtag( tag ), 0, 1 );
+	else s = fields_index_slot( f->index, fields_hashtag( tag ), level, 0 );
+
+	return s->head;
+}
+
+static int
+fields_next( fields *f, int n, int level )
+{
+	if ( !f->index )         return ( n+1 < f->n ) ? n+1 : -1;
+	if ( level==LEVEL_ANY )  return f->index->nextall[n];
+	else                     return f->index->nextlevel[n];
 }
 
 void
@@ -49,14 +312,14 @@ fields_free( fields *f )
 {
 	int i;
 
-	for ( i=0; i<f->max; ++i ) {
-		str_free( _fields_tag( f, i ) );
+	for ( i=0; i<f->max; ++i )
 		str_free( _fields_value( f, i ) );
-	}
 	if ( f->tag )   free( f->tag );
 	if ( f->value ) free( f->value );
 	if ( f->used )  free( f->used );
 	if ( f->level ) free( f->level );
+	fields_index_free( f );
+	fields_arena_free( f );
 
 	fields_init( f );
 }
@@ -71,15 +334,21 @@ fields_delete( fields *f )
 int
 fields_remove( fields *f, int n )
 {
+	str value;
 	int i;
 	if ( n<0 || n>= f->n ) return FIELDS_ERR_MEMERR;
+	fields_index_free( f ); /* positions shift, rebuild when next needed */
+	/* tags are views into the arena; keep the removed value's buffer for reuse */
+	value = f->value[n];
 	for ( i=n+1; i<f->n; ++i ) {
-		str_strcpy( _fields_tag  ( f, i-1 ), _fields_tag  ( f, i ) );
-		str_strcpy( _fields_value( f, i-1 ), _fields_value( f, i ) );
+		f->tag[i-1]   = f->tag[i];
+		f->value[i-1] = f->value[i];
 		f->used[i-1]  = f->used[i];
 		f->level[i-1] = f->level[i];
 	}
 	f->n -= 1;
+	f->value[f->n] = value;
+	str_init( _fields_tag( f, f->n ) );
 	return FIELDS_OK;
 }
 
@@ -165,7 +434,7 @@ is_duplicate_entry( fields *f, const char *tag, const char *value, int level )
 {
 	int i;
 
-	for ( i=0; i<f->n; i++ ) {
+	for ( i=fields_first( f, tag, level ); i!=-1; i=fields_next( f, i, level ) ) {
 		if ( _fields_level( f, i ) != level ) continue;
 		if ( strcasecmp( _fields_tag_char( f, i ),   tag   ) ) continue;
 		if ( strcasecmp( _fields_value_char( f, i ), value ) ) continue;
@@ -179,6 +448,8 @@ int
 _fields_add( fields *f, const char *tag, const char *value, int level, int mode )
 {
 	int n, status;
+	unsigned long len;
+	char *p;
 
 	/* Don't add incomplete entry */
 	if ( !tag || !value ) return FIELDS_OK;
@@ -193,14 +464,24 @@ _fields_add( fields *f, const char *tag, const char *value, int level, int mode
 	n = f->n;
 	f->used[ n ]  = 0;
 	f->level[ n ] = level;
-	str_strcpyc( _fields_tag( f, n ),   tag   );
-	str_strcpyc( _fields_value( f, n ), value );
 
-	if ( str_memerr( &(f->tag[n]) ) || str_memerr( &(f->value[n] ) ) )
+	len = strlen( tag );
+	p = fields_arena_strdup( f, tag, len );
+	if ( !p ) return FIELDS_ERR_MEMERR;
+	f->tag[n].data = p;
+	f->tag[n].len  = len;
+	f->tag[n].dim  = len + 1;
+
+	str_strcpyc( _fields_value( f, n ), value );
+	if ( str_memerr( &(f->value[n] ) ) )
 		return FIELDS_ERR_MEMERR;
 
 	f->n++;
 
+	/* if the index can't grow, drop it and go back to scanning */
+	if ( f->index && fields_index_add( f, n )!=FIELDS_OK )
+		fields_index_free( f );
+
 	return FIELDS_OK;
 }
 
@@ -324,7 +605,7 @@ fields_find( fields *f, const char *tag, int level )
 {
 	int i;
 
-	for ( i=0; i<f->n; ++i ) {
+	for ( i=fields_first( f, tag, level ); i!=-1; i=fields_next( f, i, level ) ) {
 		if ( !fields_match_casetag_level( f, i, tag, level ) )
 			continue;
 		if ( str_has_value( _fields_value( f, i ) ) ) return i;
@@ -502,7 +783,7 @@ fields_findv( fields *f, int level, int mode, const char *tag )
 {
 	int i, found = FIELDS_NOTFOUND;
 
-	for ( i=0; i<f->n; ++i ) {
+	for ( i=fields_first( f, tag, level ); i!=-1; i=fields_next( f, i, level ) ) {
 
 		if ( !fields_match_level( f, i, level ) ) continue;
 		if ( !fields_match_casetag( f, i, tag ) ) continue;
@@ -562,7 +843,7 @@ fields_findv_each( fields *f, int level, int mode, vplist *a, const char *tag )
 {
 	int i, status;
 
-	for ( i=0; i<f->n; ++i ) {
+	for ( i=fields_first( f, tag, level ); i!=-1; i=fields_next( f, i, level ) ) {
 
 		if ( !fields_match_level( f, i, level ) ) continue;
 		if ( !fields_match_casetag( f, i, tag ) ) continue;
@@ -609,14 +890,54 @@ fields_match_casetags( fields *f, int n, vplist *tags )
 	return 0;
 }
 
+/* fields_find_casetags()
+ *
+ * For indexed records, collect in order the positions of fields that
+ * could match any of tags at level by walking each tag's chain.  Tags
+ * that differ only in case, or whose hashes collide, share a chain, so
+ * with several tags the fields already taken are marked by position.
+ */
+static int
+fields_find_casetags( fields *f, int level, vplist *tags, intlist *pos )
+{
+	int i, j, status = FIELDS_OK;
+	unsigned char *seen = NULL;
+
+	if ( tags->n > 1 ) {
+		seen = ( unsigned char * ) calloc( f->n, sizeof( unsigned char ) );
+		if ( !seen ) return FIELDS_ERR_MEMERR;
+	}
+
+	for ( j=0; j<tags->n && status==FIELDS_OK; ++j ) {
+		for ( i=fields_first( f, vplist_get( tags, j ), level ); i!=-1; i=fields_next( f, i, level ) ) {
+			if ( seen ) {
+				if ( seen[i] ) continue;
+				seen[i] = 1;
+			}
+			if ( intlist_add( pos, i )!=INTLIST_OK ) {
+				status = FIELDS_ERR_MEMERR;
+				break;
+			}
+		}
+	}
+	if ( seen ) {
+		free( seen );
+		if ( status==FIELDS_OK ) intlist_sort( pos );
+	}
+
+	return status;
+}
+
 int
 fields_findv_eachof( fields *f, int level, int mode, vplist *a, ... )
 {
-	int i, status;
+	int i, j, n, status;
 	va_list argp;
+	intlist pos;
 	vplist tags;
 
 	vplist_init( &tags );
+	intlist_init( &pos );
 
 	/* build list of tags to search for */
 	va_start( argp, a );
@@ -624,8 +945,17 @@ fields_findv_eachof( fields *f, int level, int mode, vplist *a, ... )
 	va_end( argp );
 	if ( status!=FIELDS_OK ) goto out;
 
+	if ( fields_has_index( f ) ) {
+		status = fields_find_casetags( f, level, &tags, &pos );
+		if ( status!=FIELDS_OK ) goto out;
+		n = pos.n;
+	}
+	else n = f->n;
+
 	/* search list */
-	for ( i=0; i<f->n; ++i ) {
+	for ( j=0; j<n; ++j ) {
+
+		i = ( f->index ) ? intlist_get( &pos, j ) : j;
 
 		if ( !fields_match_level( f, i, level ) ) continue;
 		if ( !fields_match_casetags( f, i, &tags ) ) continue;
@@ -640,6 +970,7 @@ fields_findv_eachof( fields *f, int level, int mode, vplist *a, ... )
 	}
 
 out:
+	intlist_free( &pos );
 	vplist_free( &tags );
 	return status;
 }
@@ -24,6 +24,13 @@
 #include "str.h"
 #include "vplist.h"
 
+typedef struct fields_index fields_index;
+typedef struct fields_arena fields_arena;
+
+/* Tags must not be modified in place once added (values may be); their
+ * bytes live in a per-record arena and larger records keep an index
+ * over them.
+ */
 typedef struct fields {
 	str       *tag;
 	str       *value;
@@ -31,6 +38,8 @@ typedef struct fields {
 	int       *level;
 	int       n;
 	int       max;
+	fields_index *index;
+	fields_arena *arena;
 } fields;
 
 void    fields_init( fields *f );
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include "gb18030.h"
+#include "once.h"
 
 /* GB18030-2000 is an encoding of Unicode character used in China
  *
@@ -28,82 +29,170 @@ in_range( unsigned char n, unsigned char low, unsigned char high )
 	return 1;
 }
 
+/* Four-byte sequences {0x81-0xFE}{0x30-0x39}{0x81-0xFE}{0x30-0x39}
+ * are numbered consecutively; GB+81308130 is 0.
+ */
+#define GB4INDEX( a, b, c, d ) \
+	( ( ( ( (a) - 0x81 ) * 10 + ( (b) - 0x30 ) ) * 126 + ( (c) - 0x81 ) ) * 10 + ( (d) - 0x30 ) )
+
+static unsigned int
+gb18030_four_index( unsigned char *s )
+{
+	return GB4INDEX( s[0], s[1], s[2], s[3] );
+}
+
+static void
+gb18030_four_bytes( unsigned int n, unsigned char out[4] )
+{
+	out[3] = 0x30 + n % 10;  n /= 10;
+	out[2] = 0x81 + n % 126; n /= 126;
+	out[1] = 0x30 + n % 10;  n /= 10;
+	out[0] = 0x81 + n;
+}
+
+/* Roundtrip-mappings that can be enumerated
+ *
+ * Most four-byte GB 18030 mappings map linearly onto ranges of Unicode;
+ * the 31000 or so assignments outside these ranges are enumerated in
+ * gb18030_enums[].
+ */
+typedef struct gb18030_range_t {
+	unsigned int ufirst, ulast, bfirst;
+} gb18030_range_t;
+
+static const gb18030_range_t gb18030_ranges[] = {
+	{ 0x0452,  0x200F,   GB4INDEX( 0x81, 0x30, 0xD3, 0x30 ) },
+	{ 0x2643,  0x2E80,   GB4INDEX( 0x81, 0x37, 0xA8, 0x39 ) },
+	{ 0x361B,  0x3917,   GB4INDEX( 0x82, 0x30, 0xA6, 0x33 ) },
+	{ 0x3CE1,  0x4055,   GB4INDEX( 0x82, 0x31, 0xD4, 0x38 ) },
+	{ 0x4160,  0x4336,   GB4INDEX( 0x82, 0x32, 0xC9, 0x37 ) },
+	{ 0x44D7,  0x464B,   GB4INDEX( 0x82, 0x33, 0xA3, 0x39 ) },
+	{ 0x478E,  0x4946,   GB4INDEX( 0x82, 0x33, 0xE8, 0x38 ) },
+	{ 0x49B8,  0x4C76,   GB4INDEX( 0x82, 0x34, 0xA1, 0x31 ) },
+	{ 0x9FA6,  0xD7FF,   GB4INDEX( 0x82, 0x35, 0x8F, 0x33 ) },
+	{ 0xE865,  0xF92B,   GB4INDEX( 0x83, 0x36, 0xD0, 0x30 ) },
+	{ 0xFA2A,  0xFE2F,   GB4INDEX( 0x84, 0x30, 0x9C, 0x38 ) },
+	{ 0xFFE6,  0xFFFF,   GB4INDEX( 0x84, 0x31, 0xA2, 0x34 ) },
+	{ 0x10000, 0x10FFFF, GB4INDEX( 0x90, 0x30, 0x81, 0x30 ) },
+};
+
+static const int ngb18030_ranges = sizeof( gb18030_ranges ) / sizeof( gb18030_ranges[0] );
+
+/* Decoding tables
+ *
+ * Two-byte sequences index gb18030_two[] directly, as do four-byte
+ * sequences in gb18030_enums[] for gb18030_four[]; all of those fall
+ * below GB+8431A530, the end of the Basic Multilingual Plane.  Zero
+ * marks sequences with no enumerated mapping.  Both are filled from
+ * gb18030_enums[] once, on first use.
+ */
+#define GB18030_NTWO  ( 126 * 191 )
+#define GB18030_NFOUR ( GB4INDEX( 0x84, 0x31, 0xA5, 0x30 ) )
+
+static unsigned short gb18030_two[ GB18030_NTWO ];
+static unsigned short gb18030_four[ GB18030_NFOUR ];
+
+static unsigned int
+gb18030_two_index( unsigned char *s )
+{
+	return ( s[0] - 0x81 ) * 191 + ( s[1] - 0x40 );
+}
+
+static void
+gb18030_build_tables( void )
+{
+	unsigned int i, n;
+
+	for ( i=0; i<ngb18030_enums; ++i ) {
+		if ( gb18030_enums[i].len==2 ) {
+			n = gb18030_two_index( (unsigned char *) gb18030_enums[i].bytes );
+			if ( n < GB18030_NTWO && !gb18030_two[n] )
+				gb18030_two[n] = gb18030_enums[i].unicode;
+		} else if ( gb18030_enums[i].len==4 ) {
+			n = gb18030_four_index( (unsigned char *) gb18030_enums[i].bytes );
+			if ( n < GB18030_NFOUR && !gb18030_four[n] )
+				gb18030_four[n] = gb18030_enums[i].unicode;
+		}
+	}
+}
+
+static bibl_once_t gb18030_tables_once = BIBL_ONCE_INIT;
+
+static void
+gb18030_init( void )
+{
+	bibl_once( &gb18030_tables_once, gb18030_build_tables );
+}
 
 /* Get GB 18030 from Unicode Value in Table */
 static int
 gb18030_unicode_table_lookup( unsigned int unicode, unsigned char out[4] )
 {
-	int i, j;
+	int lo = 0, hi = ngb18030_enums - 1, mid, j;
 	if ( unicode >= 0x0080 && unicode <= 0xFFE5 ) {
-		/* list is sorted, so should do binary search here */
-		for ( i=0; i<ngb18030_enums; ++i ) {
-			if ( unicode == gb18030_enums[i].unicode ) {
-				for ( j=0; j<gb18030_enums[i].len; ++j )
-					out[j] = gb18030_enums[i].bytes[j];
-				return gb18030_enums[i].len;
+		/* list is sorted by unicode */
+		while ( lo <= hi ) {
+			mid = ( lo + hi ) / 2;
+			if ( gb18030_enums[mid].unicode < unicode ) lo = mid + 1;
+			else if ( gb18030_enums[mid].unicode > unicode ) hi = mid - 1;
+			else {
+				for ( j=0; j<gb18030_enums[mid].len; ++j )
+					out[j] = gb18030_enums[mid].bytes[j];
+				return gb18030_enums[mid].len;
 			}
 		}
 	}
 	return 0;
 }
 
-static int
-gb18030_match( unsigned char *s, const unsigned char *bytes, unsigned char len )
-{
-	int i;
-	for ( i=0; i<len; ++i )
-		if ( ( s[i])!=bytes[i] ) return 0;
-	return 1;
-}
-
 static unsigned int
 gb18030_table_lookup( unsigned char *uc, unsigned char len, int *found )
 {
-	unsigned int i;
-	*found = 0;
-	for ( i=0; i<ngb18030_enums; ++i ) {
-		if ( gb18030_enums[i].len!=len ) continue;
-		if ( gb18030_match( &(uc[0]), gb18030_enums[i].bytes, len ) ) {
-			*found = 1;
-			return gb18030_enums[i].unicode;
-		}
+	unsigned int n, c = 0;
+
+	gb18030_init();
+
+	if ( len==2 ) {
+		n = gb18030_two_index( uc );
+		if ( n < GB18030_NTWO ) c = gb18030_two[n];
+	} else if ( len==4 ) {
+		n = gb18030_four_index( uc );
+		if ( n < GB18030_NFOUR ) c = gb18030_four[n];
 	}
-	return '?';
+
+	*found = ( c!=0 );
+	if ( !c ) return '?';
+	return c;
 }
 
 
 static int
 gb18030_unicode_range_lookup( unsigned int unicode, unsigned char out[4] ) 
 {
+	int i;
+	for ( i=0; i<ngb18030_ranges; ++i ) {
+		if ( unicode >= gb18030_ranges[i].ufirst && unicode <= gb18030_ranges[i].ulast ) {
+			gb18030_four_bytes( gb18030_ranges[i].bfirst + ( unicode - gb18030_ranges[i].ufirst ), out );
+			return 4;
+		}
+	}
 	return 0;
 }
 
-static int
+static unsigned int
 gb18030_range_lookup( unsigned char *s, /* unsigned char len = 4 only */ int *found )
 {
+	unsigned int n = gb18030_four_index( s );
+	int i;
+	for ( i=0; i<ngb18030_ranges; ++i ) {
+		if ( n >= gb18030_ranges[i].bfirst &&
+		     n <= gb18030_ranges[i].bfirst + ( gb18030_ranges[i].ulast - gb18030_ranges[i].ufirst ) ) {
+			*found = 1;
+			return gb18030_ranges[i].ufirst + ( n - gb18030_ranges[i].bfirst );
+		}
+	}
 	*found = 0;
 	return 0;
-#if 0
-  <!-- Roundtrip-mappings that can be enumerated
-       Note that GB 18030 defines roundtrip mappings for all Unicode code points U+0000..U+10ffff.
-       This would require 1.1 million <a> elements.
-       However, most four-byte GB 18030 mappings can be enumerated efficiently within distinct ranges.
-       Therefore, we use <range> elements for all but the 31000 or so assignments above.
-    -->
-  <range uFirst="0452" uLast="200F"  bFirst="81 30 D3 30" bLast="81 36 A5 31"  bMin="81 30 81 30" bMax="FE 39 FE 39"/>
-  <range uFirst="2643" uLast="2E80"  bFirst="81 37 A8 39" bLast="81 38 FD 38"  bMin="81 30 81 30" bMax="FE 39 FE 39"/>
-  <range uFirst="361B" uLast="3917"  bFirst="82 30 A6 33" bLast="82 30 F2 37"  bMin="81 30 81 30" bMax="FE 39 FE 39"/>
-  <range uFirst="3CE1" uLast="4055"  bFirst="82 31 D4 38" bLast="82 32 AF 32"  bMin="81 30 81 30" bMax="FE 39 FE 39"/>
-  <range uFirst="4160" uLast="4336"  bFirst="82 32 C9 37" bLast="82 32 F8 37"  bMin="81 30 81 30" bMax="FE 39 FE 39"/>
-  <range uFirst="44D7" uLast="464B"  bFirst="82 33 A3 39" bLast="82 33 C9 31"  bMin="81 30 81 30" bMax="FE 39 FE 39"/>
-  <range uFirst="478E" uLast="4946"  bFirst="82 33 E8 38" bLast="82 34 96 38"  bMin="81 30 81 30" bMax="FE 39 FE 39"/>
-  <range uFirst="49B8" uLast="4C76"  bFirst="82 34 A1 31" bLast="82 34 E7 33"  bMin="81 30 81 30" bMax="FE 39 FE 39"/>
-  <range uFirst="9FA6" uLast="D7FF"  bFirst="82 35 8F 33" bLast="83 36 C7 38"  bMin="81 30 81 30" bMax="FE 39 FE 39"/>
-  <range uFirst="E865" uLast="F92B"  bFirst="83 36 D0 30" bLast="84 30 85 34"  bMin="81 30 81 30" bMax="FE 39 FE 39"/>
-  <range uFirst="FA2A" uLast="FE2F"  bFirst="84 30 9C 38" bLast="84 31 85 37"  bMin="81 30 81 30" bMax="FE 39 FE 39"/>
-  <range uFirst="FFE6" uLast="FFFF"  bFirst="84 31 A2 34" bLast="84 31 A4 39"  bMin="81 30 81 30" bMax="FE 39 FE 39"/>
-  <range uFirst="10000" uLast="10FFFF"  bFirst="90 30 81 30" bLast="E3 32 9A 35"  bMin="81 30 81 30" bMax="FE 39 FE 39"/>
-#endif
 }
 
 unsigned int
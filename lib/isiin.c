@@ -16,6 +16,7 @@
 #include "name.h"
 #include "fields.h"
 #include "reftypes.h"
+#include "once.h"
 #include "bibformats.h"
 #include "generic.h"
 
@@ -43,6 +44,8 @@ isiin_initparams( param *pm, const char *progname )
 	pm->nosplittitle     = 0;
 	pm->verbose          = 0;
 	pm->addcount         = 0;
+	pm->stream           = 0;
+	pm->nthreads         = 0;
 	pm->output_raw       = 0;
 
 	pm->readf    = isiin_readf;
@@ -52,9 +55,11 @@ isiin_initparams( param *pm, const char *progname )
 	pm->convertf = isiin_convertf;
 	pm->all      = isi_all;
 	pm->nall     = isi_nall;
+	reftypes_index_build( pm->all, pm->nall );
 
 	slist_init( &(pm->asis) );
 	slist_init( &(pm->corps) );
+	pm->macros = NULL;
 
 	if ( !progname ) pm->progname = NULL;
 	else {
@@ -365,8 +370,10 @@ static void
 isiin_report_notag( param *p, char *tag )
 {
 	if ( p->verbose && strcmp( tag, "PT" ) ) {
+		bibl_lockwarn();
 		if ( p->progname ) fprintf( stderr, "%s: ", p->progname );
 		fprintf( stderr, "Did not identify ISI tag '%s'\n", tag );
+		bibl_unlockwarn();
 	}
 }
 
@@ -409,7 +416,11 @@ isiin_convertf( fields *bibin, fields *bibout, int reftype, param *p )
 		if ( status!=BIBL_OK ) return status;
 	}
 
-	if ( status==BIBL_OK && p->verbose ) fields_report( bibout, stderr );
+	if ( status==BIBL_OK && p->verbose ) {
+		bibl_lockwarn();
+		fields_report( bibout, stderr );
+		bibl_unlockwarn();
+	}
 
 	return status;
 }
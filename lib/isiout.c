@@ -39,6 +39,8 @@ isiout_initparams( param *pm, const char *progname )
 	pm->nosplittitle     = 0;
 	pm->verbose          = 0;
 	pm->addcount         = 0;
+	pm->stream           = 0;
+	pm->nthreads         = 0;
 	pm->singlerefperfile = 0;
 
 	if ( pm->charsetout == BIBL_CHARSET_UNICODE ) {
@@ -359,6 +361,5 @@ isiout_write( fields *out, FILE *fp, param *p, unsigned long refnum )
 		);
 	}
         fprintf( fp, "ER\n\n" );
-        fflush( fp );
 	return BIBL_OK;
 }
@@ -198,13 +198,17 @@ static iso639_1_t iso639_1[] = {
 };
 static int niso639_1= sizeof( iso639_1 ) / sizeof( iso639_1[0] );
 
+/* iso639_1[] is sorted by code */
 char *
 iso639_1_from_code( const char *code )
 {
-	int i;
-	for ( i=0; i<niso639_1; ++i ) {
-		if ( !strcasecmp( iso639_1[i].code, code ) )
-			return iso639_1[i].language;
+	int lo = 0, hi = niso639_1 - 1, mid, n;
+	while ( lo <= hi ) {
+		mid = ( lo + hi ) / 2;
+		n = strcasecmp( iso639_1[mid].code, code );
+		if ( n==0 ) return iso639_1[mid].language;
+		if ( n < 0 ) lo = mid + 1;
+		else hi = mid - 1;
 	}
 	return NULL;
 }
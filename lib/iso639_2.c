@@ -1,8 +1,10 @@
 /*
  * iso639-2 language codes
  */
+#include <stdlib.h>
 #include <string.h>
 #include "iso639_2.h"
+#include "once.h"
 
 typedef struct {
 	char *code1;
@@ -586,28 +588,76 @@ static iso639_2_t iso639_2[] = {
 };
 static int niso639_2= sizeof( iso639_2 ) / sizeof( iso639_2[0] );
 
-char *
-iso639_2_from_code( char *code )
+/* Index of the codes of main iso639_2[] entries, sorted by code with
+ * ties in table order so that the first entry with a code is found, as
+ * by the linear search.  Built once, on first use.
+ */
+typedef struct {
+	char *code;
+	int n;
+} iso639_2_code_t;
+
+static iso639_2_code_t iso639_2_bycode[ 2 * sizeof( iso639_2 ) / sizeof( iso639_2[0] ) ];
+static int niso639_2_bycode = 0;
+
+static int
+iso639_2_cmpcode( const void *v1, const void *v2 )
+{
+	const iso639_2_code_t *c1 = v1, *c2 = v2;
+	int n;
+	n = strcasecmp( c1->code, c2->code );
+	if ( n ) return n;
+	return c1->n - c2->n;
+}
+
+static void
+iso639_2_build_index( void )
 {
-	int i;
+	int i, n = 0;
 	for ( i=0; i<niso639_2; ++i ) {
 		if ( !iso639_2[i].main ) continue;
-		if ( !strcasecmp( iso639_2[i].code1, code ) )
-			return iso639_2[i].language;
-		if ( iso639_2[i].code2[0]!='\0' && !strcasecmp( iso639_2[i].code2, code ) )
-			return iso639_2[i].language;
+		iso639_2_bycode[n].code = iso639_2[i].code1;
+		iso639_2_bycode[n++].n  = i;
+		if ( iso639_2[i].code2[0]=='\0' ) continue;
+		iso639_2_bycode[n].code = iso639_2[i].code2;
+		iso639_2_bycode[n++].n  = i;
 	}
+	qsort( iso639_2_bycode, n, sizeof( iso639_2_code_t ), iso639_2_cmpcode );
+	niso639_2_bycode = n;
+}
+
+static bibl_once_t iso639_2_index_once = BIBL_ONCE_INIT;
+
+char *
+iso639_2_from_code( char *code )
+{
+	int lo = 0, hi, mid;
+
+	bibl_once( &iso639_2_index_once, iso639_2_build_index );
+
+	/* first position not sorting before code */
+	hi = niso639_2_bycode;
+	while ( lo < hi ) {
+		mid = ( lo + hi ) / 2;
+		if ( strcasecmp( iso639_2_bycode[mid].code, code ) < 0 ) lo = mid + 1;
+		else hi = mid;
+	}
+	if ( lo < niso639_2_bycode && !strcasecmp( iso639_2_bycode[lo].code, code ) )
+		return iso639_2[ iso639_2_bycode[lo].n ].language;
 	return NULL;
 }
 
+/* iso639_2[] is sorted by language, see check_alphabetical() */
 char *
 iso639_2_from_language( char *lang )
 {
-	int i, n;
-	for ( i=0; i<niso639_2; ++i ) {
-		n = strcasecmp( iso639_2[i].language, lang );
-		if ( n==0 ) return iso639_2[i].code1;
-		if ( n > 0 ) return NULL;
+	int lo = 0, hi = niso639_2 - 1, mid, n;
+	while ( lo <= hi ) {
+		mid = ( lo + hi ) / 2;
+		n = strcasecmp( iso639_2[mid].language, lang );
+		if ( n==0 ) return iso639_2[mid].code1;
+		if ( n < 0 ) lo = mid + 1;
+		else hi = mid - 1;
 	}
 	return NULL;
 }
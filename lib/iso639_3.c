@@ -1,8 +1,10 @@
 /*
  * iso639_3.c
  */
+#include <stdlib.h>
 #include <string.h>
 #include "iso639_3.h"
+#include "once.h"
 
 typedef struct {
         char *code;
@@ -8407,24 +8409,61 @@ static iso639_3_t iso639_3[] = {
 };
 static int niso639_3= sizeof( iso639_3 ) / sizeof( iso639_3[0] );
 
+/* iso639_3[] is sorted by code */
 char *
 iso639_3_from_code( const char *code )
 {
-	int i;
-	for ( i=0; i<niso639_3; ++i ) {
-		if ( !strcasecmp( iso639_3[i].code, code ) )
-			return iso639_3[i].language;
+	int lo = 0, hi = niso639_3 - 1, mid, n;
+	while ( lo <= hi ) {
+		mid = ( lo + hi ) / 2;
+		n = strcasecmp( iso639_3[mid].code, code );
+		if ( n==0 ) return iso639_3[mid].language;
+		if ( n < 0 ) lo = mid + 1;
+		else hi = mid - 1;
 	}
 	return NULL;
 }
 
+/* Index of iso639_3[] sorted by language name, ties in table order so
+ * that the first entry with a name is found, as by the linear search.
+ * Built once, on first use.
+ */
+static int iso639_3_byname[ sizeof( iso639_3 ) / sizeof( iso639_3[0] ) ];
+
+static int
+iso639_3_cmpname( const void *v1, const void *v2 )
+{
+	int n1 = *( const int * ) v1, n2 = *( const int * ) v2, n;
+	n = strcasecmp( iso639_3[n1].language, iso639_3[n2].language );
+	if ( n ) return n;
+	return n1 - n2;
+}
+
+static void
+iso639_3_build_index( void )
+{
+	int i;
+	for ( i=0; i<niso639_3; ++i )
+		iso639_3_byname[i] = i;
+	qsort( iso639_3_byname, niso639_3, sizeof( int ), iso639_3_cmpname );
+}
+
+static bibl_once_t iso639_3_index_once = BIBL_ONCE_INIT;
+
 char *
 iso639_3_from_name( const char *name )
 {
-	int i;
-	for ( i=0; i<niso639_3; ++i ) {
-		if ( !strcasecmp( iso639_3[i].language, name ) )
-			return iso639_3[i].code;
+	int lo = 0, hi = niso639_3, mid;
+
+	bibl_once( &iso639_3_index_once, iso639_3_build_index );
+
+	/* first position not sorting before name */
+	while ( lo < hi ) {
+		mid = ( lo + hi ) / 2;
+		if ( strcasecmp( iso639_3[ iso639_3_byname[mid] ].language, name ) < 0 ) lo = mid + 1;
+		else hi = mid;
 	}
+	if ( lo < niso639_3 && !strcasecmp( iso639_3[ iso639_3_byname[lo] ].language, name ) )
+		return iso639_3[ iso639_3_byname[lo] ].code;
 	return NULL;
 }
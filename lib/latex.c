@@ -12,6 +12,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "latex.h"
+#include "once.h"
 
 #define LATEX_COMBO (0)  /* 'combo' no need for protection on output */
 #define LATEX_MACRO (1)  /* 'macro_name' to be protected by {\macro_name} on output */
@@ -496,15 +497,156 @@ lookup_latex( struct latex_chars *lc, int n, char *p, unsigned int *pos, int *un
 	return 0;
 }
 
+/* LaTeX decoding trie
+ *
+ * Every input variant of latex_chars[] that latex2char() would try
+ * (those starting with one of "\\\'\"`-^_lL") and of only_from_latex[]
+ * (those starting with '~' or '\\') is stored in a trie.  Each node
+ * remembers the earliest table entry, in the order the linear search
+ * tried them, whose variant ends there.  Walking the input once and
+ * keeping the earliest entry seen gives the same answer as trying every
+ * variant in turn with strncmp().
+ *
+ * If the trie cannot be allocated, latex2char() falls back to the
+ * linear search.
+ */
+typedef struct latex_node {
+	int child;          /* first node one character deeper, -1 if none */
+	int next;           /* next node with the same parent, -1 if none */
+	int rank;           /* earliest entry ending here, -1 if none */
+	unsigned char c;
+} latex_node;
+
+static latex_node *latex_trie = NULL;
+static void latex_init( void );
+static int latex_trie_first[256];
+
+#define LATEX_RANK( table_pos, variant ) ( (table_pos) * NUM_VARIANTS + (variant) )
+
+static unsigned int
+latex_rank_unicode( int rank )
+{
+	int i = rank / NUM_VARIANTS;
+	if ( i < nlatex_chars ) return latex_chars[i].unicode;
+	else return only_from_latex[i-nlatex_chars].unicode;
+}
+
+static void
+latex_trie_add( latex_node *trie, int *ntrie, const char *entry, int rank )
+{
+	int n, *link;
+
+	link = &( latex_trie_first[ (unsigned char) *entry ] );
+
+	while ( 1 ) {
+		n = *link;
+		while ( n!=-1 && trie[n].c!=(unsigned char) *entry ) n = trie[n].next;
+		if ( n==-1 ) {
+			n = (*ntrie)++;
+			trie[n].c     = (unsigned char) *entry;
+			trie[n].child = -1;
+			trie[n].rank  = -1;
+			trie[n].next  = *link;
+			*link = n;
+		}
+		entry++;
+		if ( *entry=='\0' ) break;
+		link = &( trie[n].child );
+	}
+
+	if ( trie[n].rank==-1 ) trie[n].rank = rank;
+}
+
+static int
+latex_eligible( const char *entry, const char *firstchars )
+{
+	return ( entry[0]!='\0' && strchr( firstchars, entry[0] ) );
+}
+
+static void
+latex_build_trie( void )
+{
+	struct latex_entry *variant;
+	int i, j, nchars = 0, ntrie = 0;
+	latex_node *trie;
+
+	for ( i=0; i<256; ++i ) latex_trie_first[i] = -1;
+
+	for ( i=0; i<nlatex_chars; ++i )
+		for ( j=0; j<NUM_VARIANTS && latex_chars[i].variant[j].entry; ++j )
+			nchars += latex_chars[i].variant[j].length;
+	for ( i=0; i<num_only_from_latex; ++i )
+		for ( j=0; j<NUM_VARIANTS && only_from_latex[i].variant[j].entry; ++j )
+			nchars += only_from_latex[i].variant[j].length;
+
+	trie = ( latex_node * ) malloc( sizeof( latex_node ) * nchars );
+	if ( !trie ) return;
+
+	for ( i=0; i<nlatex_chars; ++i ) {
+		for ( j=0; j<NUM_VARIANTS; ++j ) {
+			variant = &( latex_chars[i].variant[j] );
+			if ( variant->entry == NULL ) break;
+			if ( !latex_eligible( variant->entry, "\\\'\"`-^_lL" ) ) continue;
+			latex_trie_add( trie, &ntrie, variant->entry, LATEX_RANK( i, j ) );
+		}
+	}
+	for ( i=0; i<num_only_from_latex; ++i ) {
+		for ( j=0; j<NUM_VARIANTS; ++j ) {
+			variant = &( only_from_latex[i].variant[j] );
+			if ( variant->entry == NULL ) break;
+			if ( !latex_eligible( variant->entry, "~\\" ) ) continue;
+			latex_trie_add( trie, &ntrie, variant->entry, LATEX_RANK( nlatex_chars+i, j ) );
+		}
+	}
+
+	latex_trie = trie;
+}
+
+static unsigned int
+lookup_latex_trie( latex_node *trie, char *p, unsigned int *pos, int *unicode )
+{
+	int n, rank = -1, len = 0, depth = 0;
+
+	n = latex_trie_first[ (unsigned char) *p ];
+	while ( n!=-1 ) {
+		depth++;
+		if ( trie[n].rank!=-1 && ( rank==-1 || trie[n].rank < rank ) ) {
+			rank = trie[n].rank;
+			len  = depth;
+		}
+		p++;
+		if ( *p=='\0' ) break;
+		n = trie[n].child;
+		while ( n!=-1 && trie[n].c!=(unsigned char) *p ) n = trie[n].next;
+	}
+
+	if ( rank==-1 ) return 0;
+
+	*pos = *pos + len;
+	*unicode = 1;
+	return latex_rank_unicode( rank );
+}
+
 unsigned int
 latex2char( char *s, unsigned int *pos, int *unicode )
 {
 	unsigned int value, result;
+	latex_node *trie;
 	char *p;
 
 	p = &( s[*pos] );
 	value = (unsigned char) *p;
 
+	latex_init();
+	trie = latex_trie;
+	if ( trie ) {
+		result = lookup_latex_trie( trie, p, pos, unicode );
+		if ( result!=0 ) return result;
+		*unicode = 0;
+		*pos = *pos + 1;
+		return value;
+	}
+
 	if ( strchr( "\\\'\"`-^_lL", value ) ) {
 		result = lookup_latex( latex_chars, nlatex_chars, p, pos, unicode );
 		if ( result!=0 ) return result;
@@ -520,8 +662,142 @@ latex2char( char *s, unsigned int *pos, int *unicode )
 	return value;
 }
 
-void
-uni2latex( unsigned int ch, char buf[], int buf_size )
+/* latex2char_special()
+ *
+ * Return 1 if a LaTeX sequence that latex2char() decodes may start
+ * with c; for any other character latex2char() returns c itself.
+ */
+int
+latex2char_special( unsigned char c )
+{
+	latex_init();
+	if ( latex_trie ) return ( latex_trie_first[c]!=-1 );
+	return ( c!='\0' && strchr( "\\\'\"`-^_lL~", c )!=NULL );
+}
+
+/* LaTeX encoding table
+ *
+ * uni2latex() output for every code point in latex_chars[] is rendered
+ * once, with its braces or math delimiters, into a single pool.  Code
+ * points index a directory of 256-entry pages of pointers into the
+ * pool; pages with no entries are left NULL.  As with the linear
+ * search, the first entry for a code point is the one used.
+ */
+#define LATEX_PAGESIZE ( 256 )
+
+static char ***latex_out = NULL;
+static unsigned int latex_out_npages = 0;
+static char *latex_out_pool = NULL;
+
+static int
+latex_render( struct latex_chars *lc, char *buf )
+{
+	int n = 0, j;
+
+	if ( lc->type == LATEX_MACRO ) {
+		buf[n++] = '{';
+		buf[n++] = '\\';
+	}
+	else if ( lc->type == LATEX_MATH ) {
+		buf[n++] = '$';
+	}
+
+	for ( j=0; lc->out[j]; ++j )
+		buf[n++] = lc->out[j];
+
+	if ( lc->type == LATEX_MACRO ) {
+		buf[n++] = '}';
+	}
+	else if ( lc->type == LATEX_MATH ) {
+		buf[n++] = '$';
+	}
+
+	buf[n++] = '\0';
+
+	return n;
+}
+
+static void
+latex_free_out( void )
+{
+	unsigned int i;
+
+	if ( latex_out ) {
+		for ( i=0; i<latex_out_npages; ++i )
+			if ( latex_out[i] ) free( latex_out[i] );
+		free( latex_out );
+	}
+	if ( latex_out_pool ) free( latex_out_pool );
+
+	latex_out = NULL;
+	latex_out_npages = 0;
+	latex_out_pool = NULL;
+}
+
+static void
+latex_build_out( void )
+{
+	unsigned int maxuni = 0, hi, lo;
+	int i, npool = 0, pos = 0;
+
+	for ( i=0; i<nlatex_chars; ++i ) {
+		if ( latex_chars[i].unicode > maxuni ) maxuni = latex_chars[i].unicode;
+		npool += strlen( latex_chars[i].out ) + 4;
+	}
+
+	latex_out_npages = maxuni / LATEX_PAGESIZE + 1;
+	latex_out = ( char *** ) calloc( latex_out_npages, sizeof( char ** ) );
+	latex_out_pool = ( char * ) malloc( npool );
+	if ( !latex_out || !latex_out_pool ) goto err;
+
+	for ( i=0; i<nlatex_chars; ++i ) {
+		hi = latex_chars[i].unicode / LATEX_PAGESIZE;
+		lo = latex_chars[i].unicode % LATEX_PAGESIZE;
+		if ( !latex_out[hi] ) {
+			latex_out[hi] = ( char ** ) calloc( LATEX_PAGESIZE, sizeof( char * ) );
+			if ( !latex_out[hi] ) goto err;
+		}
+		if ( latex_out[hi][lo] ) continue;
+		latex_out[hi][lo] = &( latex_out_pool[pos] );
+		pos += latex_render( &(latex_chars[i]), &( latex_out_pool[pos] ) );
+	}
+
+	return;
+err:
+	latex_free_out();
+}
+
+/* latex_init()
+ *
+ * Build the decoding trie and encoding table once, on first use, so
+ * that threads converting references can share them.
+ */
+static void
+latex_build( void )
+{
+	latex_build_trie();
+	latex_build_out();
+}
+
+static bibl_once_t latex_once = BIBL_ONCE_INIT;
+
+static void
+latex_init( void )
+{
+	bibl_once( &latex_once, latex_build );
+}
+
+static const char *
+latex_lookup_out( unsigned int ch )
+{
+	unsigned int hi = ch / LATEX_PAGESIZE;
+
+	if ( hi >= latex_out_npages || !latex_out[hi] ) return NULL;
+	return latex_out[hi][ ch % LATEX_PAGESIZE ];
+}
+
+static void
+uni2latex_scan( unsigned int ch, char buf[], int buf_size )
 {
 	int i, j, n;
 
@@ -569,3 +845,61 @@ uni2latex( unsigned int ch, char buf[], int buf_size )
 
 	if ( ch < 128 ) buf[0] = (char)ch;
 }
+
+/* uni2latex_str()
+ *
+ * Return the LaTeX rendering of ch, or NULL if ch is neither in
+ * latex_chars[] nor plain ASCII (where uni2latex() gives "?").  The
+ * result normally points into a shared table and must not be modified;
+ * buf is only used if that table could not be built.
+ */
+const char *
+uni2latex_str( unsigned int ch, char buf[], int buf_size )
+{
+	static const char ascii[128][2] = {
+		"\000", "\001", "\002", "\003", "\004", "\005", "\006", "\007",
+		"\010", "\011", "\012", "\013", "\014", "\015", "\016", "\017",
+		"\020", "\021", "\022", "\023", "\024", "\025", "\026", "\027",
+		"\030", "\031", "\032", "\033", "\034", "\035", "\036", "\037",
+		" ", "!", "\"", "#", "$", "%", "&", "'", "(", ")", "*", "+", ",", "-", ".", "/",
+		"0", "1", "2", "3", "4", "5", "6", "7", "8", "9", ":", ";", "<", "=", ">", "?",
+		"@", "A", "B", "C", "D", "E", "F", "G", "H", "I", "J", "K", "L", "M", "N", "O",
+		"P", "Q", "R", "S", "T", "U", "V", "W", "X", "Y", "Z", "[", "\\", "]", "^", "_",
+		"`", "a", "b", "c", "d", "e", "f", "g", "h", "i", "j", "k", "l", "m", "n", "o",
+		"p", "q", "r", "s", "t", "u", "v", "w", "x", "y", "z", "{", "|", "}", "~", "\177",
+	};
+	const char *p;
+
+	if ( ch==' ' ) return ascii[' ']; /*special case to avoid &nbsp;*/
+
+	latex_init();
+
+	if ( !latex_out ) {
+		uni2latex_scan( ch, buf, buf_size );
+		if ( !strcmp( buf, "?" ) && ch!='?' ) return NULL;
+		return buf;
+	}
+
+	p = latex_lookup_out( ch );
+	if ( p ) return p;
+
+	if ( ch < 128 ) return ascii[ch];
+	return NULL;
+}
+
+void
+uni2latex( unsigned int ch, char buf[], int buf_size )
+{
+	const char *p;
+	int n;
+
+	if ( buf_size==0 ) return;
+
+	p = uni2latex_str( ch, buf, buf_size );
+	if ( p==buf ) return;
+	if ( !p ) p = "?";
+
+	for ( n=0; p[n] && n<buf_size-1; ++n )
+		buf[n] = p[n];
+	buf[n] = '\0';
+}
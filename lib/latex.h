@@ -10,7 +10,9 @@
 #define LATEX_H
 
 extern unsigned int latex2char( char *s, unsigned int *pos, int *unicode );
+extern int latex2char_special( unsigned char c );
 extern void uni2latex( unsigned int ch, char buf[], int buf_size );
+extern const char *uni2latex_str( unsigned int ch, char buf[], int buf_size );
 
 
 #endif
@@ -12,6 +12,7 @@
 #include "str.h"
 #include "str_conv.h"
 #include "fields.h"
+#include "intlist.h"
 #include "xml.h"
 #include "xml_encoding.h"
 #include "iso639_2.h"
@@ -37,6 +38,8 @@ medin_initparams( param *pm, const char *progname )
 	pm->nosplittitle     = 0;
 	pm->verbose          = 0;
 	pm->addcount         = 0;
+	pm->stream           = 0;
+	pm->nthreads         = 0;
 	pm->output_raw       = BIBL_RAW_WITHMAKEREFID |
 	                      BIBL_RAW_WITHCHARCONVERT;
 
@@ -50,6 +53,7 @@ medin_initparams( param *pm, const char *progname )
 
 	slist_init( &(pm->asis) );
 	slist_init( &(pm->corps) );
+	pm->macros = NULL;
 
 	if ( !progname ) pm->progname = NULL;
 	else {
@@ -85,9 +89,9 @@ medin_findstartwrapper( char *buf, int *ntype )
 }
 
 static char *
-medin_findendwrapper( char *buf, int ntype )
+medin_findendwrapper( str *s, int ntype, unsigned long *scanned )
 {
-	char *endptr = xml_find_end( buf, wrapper[ ntype ] );
+	char *endptr = xml_find_end_more( s, wrapper[ ntype ], scanned );
 	return endptr;
 }
 
@@ -96,12 +100,14 @@ medin_readf( FILE *fp, char *buf, int bufsize, int *bufpos, str *line, str *refe
 {
 	str tmp;
 	char *startptr = NULL, *endptr;
-	int haveref = 0, inref = 0, file_charset = CHARSET_UNKNOWN, m, type = -1;
+	int haveref = 0, inref = 0, file_charset = CHARSET_UNKNOWN, type = -1;
+	int sniff = ( *bufpos==0 && buf[0]=='\0' ); /* at start of stream */
+	unsigned long scanned = 0;
 	str_init( &tmp );
 	while ( !haveref && str_fget( fp, buf, bufsize, bufpos, line ) ) {
-		if ( line->data ) {
-			m = xml_getencoding( line );
-			if ( m!=CHARSET_UNKNOWN ) file_charset = m;
+		if ( sniff && str_has_value( line ) && *skip_ws( str_cstr( line ) ) ) {
+			file_charset = xml_getencoding( str_cstr( line ) );
+			sniff = 0;
 		}
 		if ( line->data ) {
 			startptr = medin_findstartwrapper( line->data, &type );
@@ -112,7 +118,7 @@ medin_readf( FILE *fp, char *buf, int bufsize, int *bufpos, str *line, str *refe
 				str_strcatc( &tmp, startptr );
 				inref = 1;
 			}
-			endptr = medin_findendwrapper( str_cstr( &tmp ), type );
+			endptr = medin_findendwrapper( &tmp, type, &scanned );
 			if ( endptr ) {
 				str_segcpy( reference, str_cstr( &tmp ), endptr );
 				haveref = 1;
@@ -288,14 +294,6 @@ medin_journal1( xml *node, fields *info )
 			}
 		}
 	}
-	if ( node->down ) {
-		status = medin_journal1( node->down, info );
-		if ( status!=BIBL_OK ) return status;
-	}
-	if ( node->next ) {
-		status = medin_journal1( node->next, info );
-		if ( status!=BIBL_OK ) return status;
-	}
 	return BIBL_OK;
 }
 
@@ -306,7 +304,7 @@ medin_journal1( xml *node, fields *info )
 static int
 medin_pagination( xml *node, fields *info )
 {
-	int i, fstatus, status;
+	int i, fstatus;
 	str sp, ep;
 	const char *p, *pp;
 	if ( xml_tag_matches( node, "MedlinePgn" ) && node->value.len ) {
@@ -330,14 +328,6 @@ medin_pagination( xml *node, fields *info )
 		}
 		strs_free( &sp, &ep, NULL );
 	}
-	if ( node->down ) {
-		status = medin_pagination( node->down, info );
-		if ( status!=BIBL_OK ) return status;
-	}
-	if ( node->next ) {
-		status = medin_pagination( node->next, info );
-		if ( status!=BIBL_OK ) return status;
-	}
 	return BIBL_OK;
 }
 
@@ -346,13 +336,14 @@ medin_pagination( xml *node, fields *info )
  * </Abstract>
  */
 static int
-medin_abstract( xml *node, fields *info )
+medin_abstract( xml *node, fields *info, int *found )
 {
 	int fstatus;
-	if ( xml_tag_matches_has_value( node, "AbstractText" ) ) {
+	if ( !*found && xml_tag_matches_has_value( node, "AbstractText" ) ) {
+		*found = 1;
 		fstatus = fields_add( info, "ABSTRACT", xml_value_cstr( node ), LEVEL_MAIN );
 		if ( fstatus!=FIELDS_OK ) return BIBL_ERR_MEMERR;
-	} else if ( node->next ) return medin_abstract( node->next, info );
+	}
 	return BIBL_OK;
 }
 
@@ -386,67 +377,37 @@ medin_author( xml *node, str *name )
 			while ( *p==' ' ) p++;
 			while ( *p && *p!=' ' ) str_addchar( name, *p++ );
 		}
-	} else if ( xml_tag_matches( node, "Initials" ) && !strchr( name->data, '|' )) {
+	} else if ( xml_tag_matches( node, "Initials" ) && !( name->data && strchr( name->data, '|' ) ) ) {
 		p = xml_value_cstr( node );
 		while ( p && *p ) {
 			if ( str_has_value( name ) ) str_addchar( name, '|' );
 			if ( !is_ws(*p) ) str_addchar( name, *p++ );
 		}
 	}
-	if ( node->next ) medin_author( node->next, name );
-	return BIBL_OK;
-}
-
-static int
-medin_corpauthor( xml *node, str *name )
-{
-	if ( xml_tag_matches( node, "CollectiveName" ) ) {
-		str_strcpy( name, xml_value( node ) );
-	} else if ( node->next ) medin_corpauthor( node->next, name );
 	return BIBL_OK;
 }
 
+/* Add the author assembled from the children of an <Author>, falling
+ * back to the first <CollectiveName> if there were no personal names.
+ */
 static int
-medin_authorlist( xml *node, fields *info )
+medin_authorlist( fields *info, str *name, str *corp, int hascorp )
 {
-	int fstatus, status = BIBL_OK;
+	int fstatus;
 	char *tag;
-	str name;
-
-	str_init( &name );
 
-	node = node->down;
-	while ( node ) {
-
-		if ( xml_tag_matches( node, "Author" ) && node->down ) {
-
-			status = medin_author( node->down, &name );
-			if ( status!=BIBL_OK ) goto out;
-
-			tag = "AUTHOR";
-			if ( str_is_empty( &name ) ) {
-				status = medin_corpauthor( node->down, &name );
-				tag = "AUTHOR:CORP";
-			}
-			if ( str_memerr( &name ) || status!=BIBL_OK ) {
-				status = BIBL_ERR_MEMERR;
-				goto out;
-			}
-			if ( str_has_value( &name ) ) {
-				fstatus = fields_add( info, tag, str_cstr( &name ), LEVEL_MAIN );
-				if ( fstatus!=FIELDS_OK ) {
-					status = BIBL_ERR_MEMERR;
-					goto out;
-				}
-			}
-			str_empty( &name );
-		}
+	tag = "AUTHOR";
+	if ( str_is_empty( name ) && hascorp ) {
+		str_strcpy( name, corp );
+		tag = "AUTHOR:CORP";
+	}
+	if ( str_memerr( name ) ) return BIBL_ERR_MEMERR;
 
-		node = node->next;
+	if ( str_has_value( name ) ) {
+		fstatus = fields_add( info, tag, str_cstr( name ), LEVEL_MAIN );
+		if ( fstatus!=FIELDS_OK ) return BIBL_ERR_MEMERR;
 	}
 
-out:
-	str_free( &name );
 	return BIBL_OK;
 }
 
@@ -468,13 +429,8 @@ medin_journal2( xml *node, fields *info )
 	int fstatus, status = BIBL_OK;
 	if ( xml_tag_matches_has_value( node, "MedlineTA" ) && fields_find( info, "TITLE", LEVEL_HOST )==FIELDS_NOTFOUND ) {
 		fstatus = fields_add( info, "TITLE", xml_value_cstr( node ), 1 );
-		if ( fstatus!=FIELDS_OK ) return BIBL_ERR_MEMERR;
-	}
-	if ( node->down ) {
-		status = medin_journal2( node->down, info );
-		if ( status!=BIBL_OK ) return status;
+		if ( fstatus!=FIELDS_OK ) status = BIBL_ERR_MEMERR;
 	}
-	if ( node->next ) status = medin_journal2( node->next, info );
 	return status;
 }
 
@@ -494,21 +450,8 @@ medin_meshheading( xml *node, fields *info )
 	int fstatus, status = BIBL_OK;
 	if ( xml_tag_matches_has_value( node, "DescriptorName" ) ) {
 		fstatus = fields_add( info, "KEYWORD", xml_value_cstr( node ), 0 );
-		if ( fstatus!=FIELDS_OK ) return BIBL_ERR_MEMERR;
-	}
-	if ( node->next ) status = medin_meshheading( node->next, info );
-	return status;
-}
-
-static int
-medin_meshheadinglist( xml *node, fields *info )
-{
-	int status = BIBL_OK;
-	if ( xml_tag_matches( node, "MeshHeading" ) && node->down ) {
-		status = medin_meshheading( node->down, info );
-		if ( status!=BIBL_OK ) return status;
+		if ( fstatus!=FIELDS_OK ) status = BIBL_ERR_MEMERR;
 	}
-	if ( node->next ) status = medin_meshheadinglist( node->next, info );
 	return status;
 }
 
@@ -548,112 +491,409 @@ medin_pubmeddata( xml *node, fields *info )
 	return BIBL_OK;
 }
 
+/* medin_state
+ *
+ * medin_processf() is driven by xml_parse_events(), keeping a mode on a
+ * stack for the children of each open element.  Fields are added as
+ * each element closes, in the order the walk of a full tree did:
+ *
+ *  - the Journal rules apply to an <Article>'s <Journal> and everything
+ *    after it, ahead of the rest of the <Article>, whose fields are held
+ *    in pending until the <Article> closes;
+ *  - <PubmedData> is expanded into a tree, as its identifiers are taken
+ *    in an order that depends on the shape of the whole element;
+ *  - elements whose own text can make a field are expanded too, and
+ *    their text converted before their children, as the walk did.
+ */
+enum {
+	MEDIN_NONE = 0,
+	MEDIN_SEARCH,
+	MEDIN_PUBMEDARTICLE,
+	MEDIN_MEDLINECITATION,
+	MEDIN_ARTICLE,
+	MEDIN_PAGINATION,
+	MEDIN_ABSTRACT,
+	MEDIN_AUTHORLIST,
+	MEDIN_AUTHOR,
+	MEDIN_JOURNALINFO,
+	MEDIN_MESHHEADINGLIST,
+	MEDIN_MESHHEADING
+};
+
+#define MEDIN_MODE     (0xff)
+#define MEDIN_HASCHILD (0x100)
+#define MEDIN_EXPANDED (0x200)
+
+typedef struct medin_state {
+	fields *info;
+	fields pending;
+	intlist modes;
+	int journal;
+	int abstract;
+	str name;
+	str corp;
+	int hascorp;
+} medin_state;
+
+static fields *
+medin_target( medin_state *s )
+{
+	if ( s->journal ) return &(s->pending);
+	else return s->info;
+}
+
+/* assume everything is a journal article */
 static int
-medin_article( xml *node, fields *info )
+medin_addresource( fields *info )
 {
-	int fstatus, status = BIBL_OK;
-	if ( xml_tag_matches( node, "Journal" ) )
-		status = medin_journal1( node, info );
-	else if ( xml_tag_matches( node, "ArticleTitle" ) )
-		status = medin_articletitle( node, info );
-	else if ( xml_tag_matches( node, "Pagination" ) && node->down )
-		status = medin_pagination( node->down, info );
-	else if ( xml_tag_matches( node, "Abstract" ) && node->down )
-		status = medin_abstract( node->down, info );
-	else if ( xml_tag_matches( node, "AuthorList" ) )
-		status = medin_authorlist( node, info );
-	else if ( xml_tag_matches( node, "Language" ) )
-		status = medin_language( node, info, LEVEL_MAIN );
-	else if ( xml_tag_matches( node, "Affiliation" ) ) {
-		fstatus = fields_add( info, "ADDRESS", xml_value_cstr( node ), LEVEL_MAIN );
+	int fstatus;
+
+	if ( fields_num( info )==0 ) return BIBL_OK;
+
+	fstatus = fields_add( info, "RESOURCE", "text", LEVEL_MAIN );
+	if ( fstatus!=FIELDS_OK ) return BIBL_ERR_MEMERR;
+	fstatus = fields_add( info, "ISSUANCE", "continuing", LEVEL_HOST );
+	if ( fstatus!=FIELDS_OK ) return BIBL_ERR_MEMERR;
+	fstatus = fields_add( info, "GENRE:MARC", "periodical", LEVEL_HOST );
+	if ( fstatus!=FIELDS_OK ) return BIBL_ERR_MEMERR;
+	fstatus = fields_add( info, "GENRE:BIBUTILS", "academic journal", LEVEL_HOST );
+	if ( fstatus!=FIELDS_OK ) return BIBL_ERR_MEMERR;
+
+	return BIBL_OK;
+}
+
+/* medin_flushpending()
+ *
+ * Entries in pending are already unique, so each need only be checked
+ * against the fields that were in info before the flush.
+ */
+static int
+medin_isdup( fields *info, int n, const char *tag, const char *value, int level )
+{
+	int i;
+
+	for ( i=0; i<n; ++i ) {
+		if ( !fields_match_casetag_level( info, i, tag, level ) ) continue;
+		if ( strcasecmp( fields_value( info, i, FIELDS_CHRP_NOUSE ), value ) ) continue;
+		return 1;
+	}
+
+	return 0;
+}
+
+static int
+medin_flushpending( medin_state *s )
+{
+	int i, n, level, fstatus, status = BIBL_OK;
+	char *tag, *value;
+
+	n = fields_num( s->info );
+
+	for ( i=0; i<fields_num( &(s->pending) ) && status==BIBL_OK; ++i ) {
+		tag   = fields_tag( &(s->pending), i, FIELDS_CHRP_NOUSE );
+		value = fields_value( &(s->pending), i, FIELDS_CHRP_NOUSE );
+		level = fields_level( &(s->pending), i );
+		if ( medin_isdup( s->info, n, tag, value, level ) ) continue;
+		fstatus = fields_add_can_dup( s->info, tag, value, level );
 		if ( fstatus!=FIELDS_OK ) status = BIBL_ERR_MEMERR;
 	}
-	if ( status!=BIBL_OK ) return status;
-	if ( node->next ) status = medin_article( node->next, info );
+
+	fields_free( &(s->pending) );
+	fields_init( &(s->pending) );
+
 	return status;
 }
 
+/* medin_hasown()
+ *
+ * Whether medin_own() can add a field from node's own text, given the
+ * mode of its parent.  Such elements are expanded so their text is
+ * converted ahead of anything below them.
+ */
 static int
-medin_medlinecitation( xml *node, fields *info )
+medin_hasown( xml *node, medin_state *s, int parent )
 {
-	int fstatus, status = BIBL_OK;
-	if ( xml_tag_matches_has_value( node, "PMID" ) ) {
-		fstatus = fields_add( info, "PMID", xml_value_cstr( node ), LEVEL_MAIN );
-		if ( fstatus!=FIELDS_OK ) return BIBL_ERR_MEMERR;
+	char *journal[] = { "Title", "ISOAbbreviation", "ISSN", "Volume", "Issue",
+		"Year", "Month", "Day", "MedlineDate", "Language" };
+	int i, njournal = sizeof( journal ) / sizeof( journal[0] ), has = 0;
+
+	switch ( parent ) {
+	case MEDIN_MEDLINECITATION:
+		has = xml_tag_matches( node, "PMID" );
+		break;
+	case MEDIN_ARTICLE:
+		has = xml_tag_matches( node, "ArticleTitle" ) ||
+		      xml_tag_matches( node, "Language" ) ||
+		      xml_tag_matches( node, "Affiliation" );
+		break;
+	case MEDIN_PAGINATION:
+		has = xml_tag_matches( node, "MedlinePgn" );
+		break;
+	case MEDIN_ABSTRACT:
+		has = xml_tag_matches( node, "AbstractText" );
+		break;
+	case MEDIN_AUTHOR:
+		has = xml_tag_matches( node, "LastName" ) ||
+		      xml_tag_matches( node, "ForeName" ) ||
+		      xml_tag_matches( node, "FirstName" ) ||
+		      xml_tag_matches( node, "Initials" ) ||
+		      xml_tag_matches( node, "CollectiveName" );
+		break;
+	case MEDIN_JOURNALINFO:
+		has = xml_tag_matches( node, "MedlineTA" );
+		break;
+	case MEDIN_MESHHEADING:
+		has = xml_tag_matches( node, "DescriptorName" );
+		break;
 	}
-	if ( node->down ) {
-		if ( xml_tag_matches( node, "Article" ) ) {
-			status = medin_article( node->down, info );
-		} else if ( xml_tag_matches( node, "MedlineJournalInfo" ) ) {
-			status = medin_journal2( node->down, info );
-		} else if ( xml_tag_matches( node, "MeshHeadingList" ) )
-			status = medin_meshheadinglist( node->down, info );
-		if ( status!=BIBL_OK ) return status;
+
+	if ( !has && s->journal ) {
+		for ( i=0; i<njournal && !has; ++i )
+			has = xml_tag_matches( node, journal[i] );
 	}
-	if ( node->next ) status = medin_medlinecitation( node->next, info );
-	return status;
+
+	return has;
 }
 
 static int
-medin_pubmedarticle( xml *node, fields *info )
+medin_start( xml *node, void *data )
 {
-	int status = BIBL_OK;
-	if ( node->down ) {
+	medin_state *s = ( medin_state * ) data;
+	int parent = MEDIN_SEARCH, mode = MEDIN_NONE, expand = 0;
+
+	if ( s->modes.n ) {
+		s->modes.data[ s->modes.n-1 ] |= MEDIN_HASCHILD;
+		parent = s->modes.data[ s->modes.n-1 ] & MEDIN_MODE;
+	}
+
+	switch ( parent ) {
+	case MEDIN_SEARCH:
+		if ( xml_tag_matches( node, "PubmedArticle" ) )
+			mode = MEDIN_PUBMEDARTICLE;
+		else if ( xml_tag_matches( node, "MedlineCitation" ) )
+			mode = MEDIN_MEDLINECITATION;
+		else
+			mode = MEDIN_SEARCH;
+		break;
+	case MEDIN_PUBMEDARTICLE:
 		if ( xml_tag_matches( node, "MedlineCitation" ) )
-			status = medin_medlinecitation( node->down, info );
+			mode = MEDIN_MEDLINECITATION;
 		else if ( xml_tag_matches( node, "PubmedData" ) )
-			status = medin_pubmeddata( node->down, info );
+			expand = 1;
+		break;
+	case MEDIN_MEDLINECITATION:
+		if ( xml_tag_matches( node, "Article" ) )
+			mode = MEDIN_ARTICLE;
+		else if ( xml_tag_matches( node, "MedlineJournalInfo" ) )
+			mode = MEDIN_JOURNALINFO;
+		else if ( xml_tag_matches( node, "MeshHeadingList" ) )
+			mode = MEDIN_MESHHEADINGLIST;
+		break;
+	case MEDIN_ARTICLE:
+		if ( xml_tag_matches( node, "Journal" ) )
+			s->journal = 1;
+		else if ( xml_tag_matches( node, "Pagination" ) )
+			mode = MEDIN_PAGINATION;
+		else if ( xml_tag_matches( node, "Abstract" ) ) {
+			mode = MEDIN_ABSTRACT;
+			s->abstract = 0;
+		}
+		else if ( xml_tag_matches( node, "AuthorList" ) )
+			mode = MEDIN_AUTHORLIST;
+		break;
+	case MEDIN_PAGINATION:
+	case MEDIN_JOURNALINFO:
+		mode = parent;
+		break;
+	case MEDIN_AUTHORLIST:
+		if ( xml_tag_matches( node, "Author" ) ) {
+			mode = MEDIN_AUTHOR;
+			str_empty( &(s->name) );
+			str_empty( &(s->corp) );
+			s->hascorp = 0;
+		}
+		break;
+	case MEDIN_MESHHEADINGLIST:
+		if ( xml_tag_matches( node, "MeshHeading" ) )
+			mode = MEDIN_MESHHEADING;
+		break;
+	}
+
+	if ( !expand && medin_hasown( node, s, parent ) ) {
+		mode |= MEDIN_EXPANDED;
+		expand = 1;
+	}
+
+	if ( intlist_add( &(s->modes), mode )!=INTLIST_OK ) return BIBL_ERR_MEMERR;
+
+	if ( expand ) return XML_EVENTS_EXPAND;
+	return BIBL_OK;
+}
+
+/* medin_own()
+ *
+ * Add the fields from node's own text.
+ */
+static int
+medin_own( xml *node, medin_state *s, int own, int parent )
+{
+	int status = BIBL_OK, fstatus;
+
+	if ( s->journal && ( own & MEDIN_MODE )!=MEDIN_ARTICLE ) {
+		status = medin_journal1( node, s->info );
 		if ( status!=BIBL_OK ) return status;
 	}
-	if ( node->next ) status = medin_pubmedarticle( node->next, info );
+
+	switch ( parent ) {
+	case MEDIN_PUBMEDARTICLE:
+		if ( xml_tag_matches( node, "PubmedData" ) && node->down )
+			status = medin_pubmeddata( node->down, s->info );
+		break;
+	case MEDIN_MEDLINECITATION:
+		if ( xml_tag_matches_has_value( node, "PMID" ) ) {
+			fstatus = fields_add( s->info, "PMID", xml_value_cstr( node ), LEVEL_MAIN );
+			if ( fstatus!=FIELDS_OK ) status = BIBL_ERR_MEMERR;
+		}
+		break;
+	case MEDIN_ARTICLE:
+		if ( xml_tag_matches( node, "ArticleTitle" ) )
+			status = medin_articletitle( node, medin_target( s ) );
+		else if ( xml_tag_matches( node, "Language" ) )
+			status = medin_language( node, medin_target( s ), LEVEL_MAIN );
+		else if ( xml_tag_matches( node, "Affiliation" ) ) {
+			fstatus = fields_add( medin_target( s ), "ADDRESS", xml_value_cstr( node ), LEVEL_MAIN );
+			if ( fstatus!=FIELDS_OK ) status = BIBL_ERR_MEMERR;
+		}
+		break;
+	case MEDIN_PAGINATION:
+		status = medin_pagination( node, medin_target( s ) );
+		break;
+	case MEDIN_ABSTRACT:
+		status = medin_abstract( node, medin_target( s ), &(s->abstract) );
+		break;
+	case MEDIN_AUTHOR:
+		if ( !s->hascorp && xml_tag_matches( node, "CollectiveName" ) ) {
+			str_strcpy( &(s->corp), xml_value( node ) );
+			s->hascorp = 1;
+		}
+		status = medin_author( node, &(s->name) );
+		break;
+	case MEDIN_JOURNALINFO:
+		status = medin_journal2( node, s->info );
+		break;
+	case MEDIN_MESHHEADING:
+		status = medin_meshheading( node, s->info );
+		break;
+	}
+
 	return status;
 }
 
+/* medin_close()
+ *
+ * Finish off an element once everything below it has been seen.
+ */
 static int
-medin_assembleref( xml *node, fields *info )
+medin_close( medin_state *s, int own, int parent )
 {
 	int status = BIBL_OK;
-	if ( node->down ) {
-		if ( xml_tag_matches( node, "PubmedArticle" ) )
-			status = medin_pubmedarticle( node->down, info );
-		else if ( xml_tag_matches( node, "MedlineCitation" ) )
-			status = medin_medlinecitation( node->down, info );
-		else
-			status = medin_assembleref( node->down, info );
+
+	switch ( parent ) {
+	case MEDIN_SEARCH:
+		if ( ( own & MEDIN_MODE )==MEDIN_SEARCH && ( own & MEDIN_HASCHILD ) )
+			status = medin_addresource( s->info );
+		break;
+	case MEDIN_AUTHORLIST:
+		if ( ( own & MEDIN_MODE )==MEDIN_AUTHOR && ( own & MEDIN_HASCHILD ) )
+			status = medin_authorlist( medin_target( s ), &(s->name), &(s->corp), s->hascorp );
+		break;
 	}
 	if ( status!=BIBL_OK ) return status;
 
-	if ( node->next ) {
-		status = medin_assembleref( node->next, info );
+	if ( ( own & MEDIN_MODE )==MEDIN_ARTICLE && s->journal ) {
+		s->journal = 0;
+		status = medin_flushpending( s );
+	}
+
+	return status;
+}
+
+static int medin_walk( xml *node, medin_state *s );
+
+/* medin_end()
+ *
+ * The children of an expanded element arrive as a tree in node->down
+ * and are walked between its own text and its close.
+ */
+static int
+medin_end( xml *node, void *data )
+{
+	medin_state *s = ( medin_state * ) data;
+	int own, parent = MEDIN_SEARCH, status;
+
+	own = s->modes.data[ s->modes.n-1 ];
+	if ( s->modes.n > 1 ) parent = s->modes.data[ s->modes.n-2 ] & MEDIN_MODE;
+
+	status = medin_own( node, s, own, parent );
+	if ( status!=BIBL_OK ) return status;
+
+	/* ...children are walked with node's mode still on the stack */
+	if ( own & MEDIN_EXPANDED ) {
+		status = medin_walk( node->down, s );
 		if ( status!=BIBL_OK ) return status;
 	}
 
-	/* assume everything is a journal article */
-	if ( fields_num( info ) ) {
-		status = fields_add( info, "RESOURCE", "text", LEVEL_MAIN );
-		if ( status!=FIELDS_OK ) return BIBL_ERR_MEMERR;
-		status = fields_add( info, "ISSUANCE", "continuing", LEVEL_HOST );
-		if ( status!=FIELDS_OK ) return BIBL_ERR_MEMERR;
-		status = fields_add( info, "GENRE:MARC", "periodical", LEVEL_HOST );
-		if ( status!=FIELDS_OK ) return BIBL_ERR_MEMERR;
-		status = fields_add( info, "GENRE:BIBUTILS", "academic journal", LEVEL_HOST );
-		if ( status!=FIELDS_OK ) return BIBL_ERR_MEMERR;
-		status = BIBL_OK;
+	own = s->modes.data[ --(s->modes.n) ];
+
+	return medin_close( s, own, parent );
+}
+
+/* medin_walk()
+ *
+ * Replay the events for a chain of expanded elements in tree order.
+ */
+static int
+medin_walk( xml *node, medin_state *s )
+{
+	int status;
+
+	for ( ; node; node=node->next ) {
+		status = medin_start( node, s );
+		if ( status!=BIBL_OK && status!=XML_EVENTS_EXPAND ) return status;
+		s->modes.data[ s->modes.n-1 ] |= MEDIN_EXPANDED;
+		status = medin_end( node, s );
+		if ( status!=BIBL_OK ) return status;
 	}
 
-	return status;
+	return BIBL_OK;
 }
 
 static int
 medin_processf( fields *medin, const char *data, const char *filename, long nref, param *p )
 {
+	xml_events events;
+	medin_state s;
 	int status;
-	xml top;
 
-	xml_init( &top );
-	xml_parse( data, &top );
-	status = medin_assembleref( &top, medin );
-	xml_free( &top );
+	s.info     = medin;
+	s.journal  = 0;
+	s.abstract = 0;
+	s.hascorp  = 0;
+	fields_init( &(s.pending) );
+	intlist_init( &(s.modes) );
+	strs_init( &(s.name), &(s.corp), NULL );
+
+	events.start = medin_start;
+	events.end   = medin_end;
+	events.data  = &s;
+
+	status = xml_parse_events( data, &events );
+	if ( status==XML_EVENTS_MEMERR ) status = BIBL_ERR_MEMERR;
+	if ( status==BIBL_OK ) status = medin_addresource( medin );
+
+	strs_free( &(s.name), &(s.corp), NULL );
+	intlist_free( &(s.modes) );
+	fields_free( &(s.pending) );
 
 	if ( status==BIBL_OK ) return 1;
 	return 0;
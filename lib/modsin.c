@@ -16,6 +16,7 @@
 #include "xml.h"
 #include "xml_encoding.h"
 #include "fields.h"
+#include "intlist.h"
 #include "name.h"
 #include "reftypes.h"
 #include "modstypes.h"
@@ -48,6 +49,8 @@ modsin_initparams( param *pm, const char *progname )
 	pm->nosplittitle     = 0;
 	pm->verbose          = 0;
 	pm->addcount         = 0;
+	pm->stream           = 0;
+	pm->nthreads         = 0;
 	pm->singlerefperfile = 0;
 	pm->output_raw       = BIBL_RAW_WITHMAKEREFID |
 	                      BIBL_RAW_WITHCHARCONVERT;
@@ -62,6 +65,7 @@ modsin_initparams( param *pm, const char *progname )
 
 	slist_init( &(pm->asis) );
 	slist_init( &(pm->corps) );
+	pm->macros = NULL;
 
 	if ( !progname ) pm->progname = NULL;
 	else {
@@ -992,8 +996,14 @@ modsin_identifier( xml *node, fields *info, int level )
 	return BIBL_OK;
 }
 
+static int modsin_mods( xml *node, fields *info, int level );
+
+/* modsin_mods1()
+ *
+ * Convert one child of a <mods> or <relatedItem> element.
+ */
 static int
-modsin_mods( xml *node, fields *info, int level )
+modsin_mods1( xml *node, fields *info, int level )
 {
 	convert simple[] = {
 		{ "note",            "NOTES",    0, 0 },
@@ -1057,44 +1067,93 @@ modsin_mods( xml *node, fields *info, int level )
 		else if ( xml_tag_has_attribute( node, "relatedItem", "type", "original" ) ) {
 			if ( node->down ) status = modsin_mods( node->down, info, LEVEL_ORIG );
 		}
-
-		if ( status!=BIBL_OK ) return status;
 	}
 
-	if ( node->next ) status = modsin_mods( node->next, info, level );
-
 	return status;
 }
 
 static int
-modsin_assembleref( xml *node, fields *info )
+modsin_mods( xml *node, fields *info, int level )
 {
 	int status = BIBL_OK;
-	if ( xml_tag_matches( node, "mods" ) ) {
-		status = modsin_id1( node, info, 0 );
-		if ( status!=BIBL_OK ) return status;
-		if ( node->down ) {
-			status = modsin_mods( node->down, info, 0 );
-			if ( status!=BIBL_OK ) return status;
+
+	for ( ; node && status==BIBL_OK; node=node->next )
+		status = modsin_mods1( node, info, level );
+
+	return status;
+}
+
+/* modsin_state
+ *
+ * modsin_processf() is driven by xml_parse_events(), keeping a mode on
+ * a stack for the children of each open element.  Outside of <mods>
+ * elements are only searched; each child of a <mods> is expanded into
+ * a tree and converted as it closes, so a reference never holds more
+ * than one top-level element at a time.
+ */
+enum {
+	MODSIN_SEARCH = 0,
+	MODSIN_MODS,
+	MODSIN_CHILD
+};
+
+typedef struct modsin_state {
+	fields *info;
+	intlist modes;
+} modsin_state;
+
+static int
+modsin_start( xml *node, void *data )
+{
+	modsin_state *s = ( modsin_state * ) data;
+	int parent = MODSIN_SEARCH, mode = MODSIN_SEARCH, status = BIBL_OK;
+
+	if ( s->modes.n ) parent = s->modes.data[ s->modes.n-1 ];
+
+	if ( parent==MODSIN_SEARCH ) {
+		if ( xml_tag_matches( node, "mods" ) ) {
+			mode = MODSIN_MODS;
+			status = modsin_id1( node, s->info, 0 );
 		}
-	} else if ( node->down ) {
-		status = modsin_assembleref( node->down, info );
-		if ( status!=BIBL_OK ) return status;
 	}
-	if ( node->next ) status = modsin_assembleref( node->next, info );
+	else if ( parent==MODSIN_MODS ) {
+		mode = MODSIN_CHILD;
+		status = XML_EVENTS_EXPAND;
+	}
+
+	if ( intlist_add( &(s->modes), mode )!=INTLIST_OK ) return BIBL_ERR_MEMERR;
+
 	return status;
 }
 
+static int
+modsin_end( xml *node, void *data )
+{
+	modsin_state *s = ( modsin_state * ) data;
+
+	if ( s->modes.data[ --(s->modes.n) ]==MODSIN_CHILD )
+		return modsin_mods1( node, s->info, 0 );
+
+	return BIBL_OK;
+}
+
 static int
 modsin_processf( fields *modsin, const char *data, const char *filename, long nref, param *p )
 {
+	xml_events events;
+	modsin_state s;
 	int status;
-	xml top;
 
-	xml_init( &top );
-	xml_parse( data, &top );
-	status = modsin_assembleref( &top, modsin );
-	xml_free( &top );
+	s.info = modsin;
+	intlist_init( &(s.modes) );
+
+	events.start = modsin_start;
+	events.end   = modsin_end;
+	events.data  = &s;
+
+	status = xml_parse_events( data, &events );
+
+	intlist_free( &(s.modes) );
 
 	if ( status==BIBL_OK ) return 1;
 	else return 0;
@@ -1105,17 +1164,17 @@ modsin_processf( fields *modsin, const char *data, const char *filename, long nr
 *****************************************************/
 
 static char *
-modsin_startptr( char *p, char **next )
+modsin_startptr( str *s, unsigned long scanned[2], char **next )
 {
 	char *startptr;
 	*next = NULL;
-	startptr = xml_find_start( p, "mods:mods" );
+	startptr = xml_find_start_more( s, "mods:mods", &(scanned[0]) );
 	if ( startptr ) {
 		/* set namespace if found */
 		xml_pns = modsns;
 		*next = startptr + 9;
 	} else {
-		startptr = xml_find_start( p, "mods" );
+		startptr = xml_find_start_more( s, "mods", &(scanned[1]) );
 		if ( startptr ) {
 			xml_pns = NULL;
 			*next = startptr + 5;
@@ -1125,31 +1184,49 @@ modsin_startptr( char *p, char **next )
 }
 
 static char *
-modsin_endptr( char *p )
+modsin_endptr( str *s, unsigned long *scanned )
 {
-	return xml_find_end( p, "mods" );
+	return xml_find_end_more( s, "mods", scanned );
 }
 
+/* modsin_readf()
+ *
+ * Lines are added to tmp until the end of the record is seen, keeping
+ * track of how much has been searched so each search only looks at
+ * new text.  A <mods:mods> start is preferred to a plain <mods> found
+ * earlier (e.g. in a comment), so it is looked for until the record ends.
+ */
 static int
 modsin_readf( FILE *fp, char *buf, int bufsize, int *bufpos, str *line, str *reference, int *fcharset )
 {
 	str tmp;
-	int m, file_charset = CHARSET_UNKNOWN;
-	char *startptr = NULL, *nextptr, *endptr = NULL;
+	int file_charset = CHARSET_UNKNOWN;
+	int sniff = ( *bufpos==0 && buf[0]=='\0' ); /* at start of stream */
+	char *startptr = NULL, *nextptr, *endptr = NULL, *p;
+	unsigned long startscan[2] = { 0, 0 }, start = 0, endscan = 0;
 
 	str_init( &tmp );
 
 	do {
+		if ( sniff && str_has_value( line ) && *skip_ws( str_cstr( line ) ) ) {
+			file_charset = xml_getencoding( str_cstr( line ) );
+			sniff = 0;
+		}
 		if ( line->data ) str_strcat( &tmp, line );
 		if ( str_has_value( &tmp ) ) {
-			m = xml_getencoding( &tmp );
-			if ( m!=CHARSET_UNKNOWN ) file_charset = m;
-			startptr = modsin_startptr( tmp.data, &nextptr );
-			if ( nextptr ) endptr = modsin_endptr( nextptr );
-		} else startptr = endptr = NULL;
+			if ( !startptr || !xml_pns ) {
+				p = modsin_startptr( &tmp, startscan, &nextptr );
+				if ( p && ( !startptr || xml_pns ) ) {
+					startptr = p;
+					start    = startptr - tmp.data;
+					endscan  = nextptr  - tmp.data;
+				}
+			}
+			if ( startptr ) endptr = modsin_endptr( &tmp, &endscan );
+		}
 		str_empty( line );
 		if ( startptr && endptr ) {
-			str_segcpy( reference, startptr, endptr );
+			str_segcpy( reference, tmp.data + start, endptr );
 			str_strcpyc( line, endptr );
 		}
 	} while ( !endptr && str_fget( fp, buf, bufsize, bufpos, line ) );
@@ -20,6 +20,7 @@
 #include "modstypes.h"
 #include "bu_auth.h"
 #include "marc_auth.h"
+#include "once.h"
 #include "bibformats.h"
 
 /*****************************************************
@@ -44,6 +45,8 @@ modsout_initparams( param *pm, const char *progname )
 	pm->nosplittitle     = 0;
 	pm->verbose          = 0;
 	pm->addcount         = 0;
+	pm->stream           = 0;
+	pm->nthreads         = 0;
 	pm->singlerefperfile = 0;
 
 	pm->headerf   = modsout_writeheader;
@@ -1087,6 +1090,7 @@ modsout_report_unused_tags( fields *f, param *p, unsigned long numrefs )
 		nunused++;
 	}
 	if ( nunused ) {
+		bibl_lockwarn();
 		if ( p->progname ) fprintf( stderr, "%s: ", p->progname );
 		fprintf( stderr, "Reference %lu has unused tags.\n", numrefs+1 );
 		/* Find author from level 0 */
@@ -1130,6 +1134,7 @@ modsout_report_unused_tags( fields *f, param *p, unsigned long numrefs )
 			fprintf( stderr, "\t\ttag: '%s' value: '%s' level: %d\n",
 				tag, value, level );
 		}
+		bibl_unlockwarn();
 	}
 }
 
@@ -1145,7 +1150,6 @@ modsout_write( fields *f, FILE *outptr, param *p, unsigned long numrefs )
 	modsout_report_unused_tags( f, p, numrefs );
 
 	fprintf( outptr, "</mods>\n" );
-	fflush( outptr );
 
 	return BIBL_OK;
 }
@@ -33,6 +33,8 @@ bibtexout_initparams( param *pm, const char *progname )
 	pm->nosplittitle     = 0;
 	p->verbose          = 0;
 	pm->addcount         = 0;
+	pm->stream           = 0;
+	pm->nthreads         = 0;
 	pm->singlerefperfile = 0;
 
 	pm->headerf = bibtexout_writeheader;
@@ -19,6 +19,7 @@
 #include "url.h"
 #include "serialno.h"
 #include "reftypes.h"
+#include "once.h"
 #include "bibformats.h"
 #include "generic.h"
 
@@ -46,6 +47,8 @@ nbibin_initparams( param *pm, const char *progname )
 	pm->nosplittitle     = 0;
 	pm->verbose          = 0;
 	pm->addcount         = 0;
+	pm->stream           = 0;
+	pm->nthreads         = 0;
 	pm->output_raw       = 0;
 
 	pm->readf    = nbib_readf;
@@ -55,9 +58,11 @@ nbibin_initparams( param *pm, const char *progname )
 	pm->convertf = nbib_convertf;
 	pm->all      = nbib_all;
 	pm->nall     = nbib_nall;
+	reftypes_index_build( pm->all, pm->nall );
 
 	slist_init( &(pm->asis) );
 	slist_init( &(pm->corps) );
+	pm->macros = NULL;
 
 	if ( !progname ) pm->progname = NULL;
 	else {
@@ -281,9 +286,11 @@ nbib_typef( fields *nbib, const char *filename, int nref, param *p )
 	if ( a.n==0 )
 		reftype = get_reftype( "", nref, p->progname, p->all, p->nall, refname, &is_default, REFTYPE_CHATTY );
 	else if ( is_default ) {
+                bibl_lockwarn();
                 if ( p->progname ) fprintf( stderr, "%s: ", p->progname );
                 fprintf( stderr, "Did not recognize type of refnum %d (%s).\n"
                         "\tDefaulting to %s.\n", nref, refname, p->all[0].type );
+                bibl_unlockwarn();
 	}
 
 	vplist_free( &a );
@@ -468,8 +475,10 @@ static void
 nbib_report_notag( param *p, char *tag )
 {
 	if ( p->verbose && strcmp( tag, "TY" ) ) {
+		bibl_lockwarn();
 		if ( p->progname ) fprintf( stderr, "%s: ", p->progname );
 		fprintf( stderr, "Did not identify NBIB tag '%s'\n", tag );
+		bibl_unlockwarn();
 	}
 }
 
@@ -504,7 +513,11 @@ nbib_convertf( fields *bibin, fields *bibout, int reftype, param *p )
 		if ( status!=BIBL_OK ) return status;
 	}
 
-	if ( status==BIBL_OK && p->verbose ) fields_report( bibout, stderr );
+	if ( status==BIBL_OK && p->verbose ) {
+		bibl_lockwarn();
+		fields_report( bibout, stderr );
+		bibl_unlockwarn();
+	}
 
 	return status;
 }
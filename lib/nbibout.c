@@ -18,6 +18,7 @@
 #include "iso639_3.h"
 #include "title.h"
 #include "bibutils.h"
+#include "once.h"
 #include "bibformats.h"
 
 /*****************************************************
@@ -40,6 +41,8 @@ nbibout_initparams( param *pm, const char *progname )
 	pm->nosplittitle     = 0;
 	pm->verbose          = 0;
 	pm->addcount         = 0;
+	pm->stream           = 0;
+	pm->nthreads         = 0;
 	pm->singlerefperfile = 0;
 
 	if ( pm->charsetout == BIBL_CHARSET_UNICODE ) {
@@ -444,6 +447,7 @@ output_verbose( fields *f, const char *type, unsigned long refnum )
 	char *tag, *value;
 	int i, n, level;
 
+	bibl_lockwarn();
 	fprintf( stderr, "REF #%lu %s---\n", refnum+1, type );
 
 	n = fields_num( f );
@@ -455,6 +459,7 @@ output_verbose( fields *f, const char *type, unsigned long refnum )
 	}
 
 	fflush( stderr );
+	bibl_unlockwarn();
 }
 
 static void
@@ -462,11 +467,9 @@ output_tag( FILE *fp, char *p )
 {
 	int i = 0;
 
-	while ( i < 4 && p && *p ) {
-		fprintf( fp, "%c", *p );
+	while ( i < 4 && p && p[i] )
 		i++;
-		p++;
-	}
+	if ( i ) fwrite( p, 1, i, fp );
 
 	for ( ; i<4; ++i )
 		fprintf( fp, " " );
@@ -495,17 +498,11 @@ output_value( FILE *fp, str *value )
 			n++;
 		}
 		if ( *q && lastws ) {
-			while ( p!=lastws ) {
-				fprintf( fp, "%c", *p );
-				p++;
-			}
-			p++; /* skip ws separator */
+			fwrite( p, 1, lastws-p, fp );
+			p = lastws + 1; /* skip ws separator */
 		}
 		else {
-			while ( p!=q ) {
-				fprintf( fp, "%c", *p );
-				p++;
-			}
+			fwrite( p, 1, q-p, fp );
 			p = q;
 		}
 		if ( *p ) {
@@ -528,7 +525,6 @@ output_reference( FILE *fp, fields *out )
 	}
 
         fprintf( fp, "\n\n" );
-        fflush( fp );
 }
 
 static int
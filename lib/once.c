@@ -0,0 +1,86 @@
+/*
+ * once.c
+ *
+ * Lazily built lookup tables are shared by every reference and, with
+ * --jobs, every thread; build them through here so that happens exactly
+ * once.  Compiled with BIBL_NOTHREADS these reduce to a flag.
+ *
+ * Also holds the lock that keeps a warning printed with several calls
+ * in one piece when references are converted or written in parallel.
+ *
+ * Copyright (c) agent 2026
+ *
+ * Source code released under the GPL version 2
+ *
+ */
+#include "once.h"
+
+/* bibl_once()
+ *
+ * Run f the first time this is called with once, which must start out
+ * as BIBL_ONCE_INIT; later callers wait until f has finished.
+ */
+void
+bibl_once( bibl_once_t *once, void (*f)( void ) )
+{
+#ifndef BIBL_NOTHREADS
+	pthread_once( once, f );
+#else
+	if ( !*once ) {
+		f();
+		*once = 1;
+	}
+#endif
+}
+
+#ifndef BIBL_NOTHREADS
+static pthread_mutex_t bibl_setup_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/* bibl_lock()
+ * bibl_unlock()
+ *
+ * Serialize one-time setup that depends on its arguments and so cannot
+ * be run through bibl_once().  Not to be held across another bibl_lock().
+ */
+void
+bibl_lock( void )
+{
+#ifndef BIBL_NOTHREADS
+	pthread_mutex_lock( &bibl_setup_lock );
+#endif
+}
+
+void
+bibl_unlock( void )
+{
+#ifndef BIBL_NOTHREADS
+	pthread_mutex_unlock( &bibl_setup_lock );
+#endif
+}
+
+#ifndef BIBL_NOTHREADS
+static pthread_mutex_t bibl_warn_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/* bibl_lockwarn()
+ * bibl_unlockwarn()
+ *
+ * Hold around a warning to stderr that takes more than one call, so that
+ * a warning from another thread cannot land in the middle of it.
+ */
+void
+bibl_lockwarn( void )
+{
+#ifndef BIBL_NOTHREADS
+	pthread_mutex_lock( &bibl_warn_lock );
+#endif
+}
+
+void
+bibl_unlockwarn( void )
+{
+#ifndef BIBL_NOTHREADS
+	pthread_mutex_unlock( &bibl_warn_lock );
+#endif
+}
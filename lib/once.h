@@ -0,0 +1,27 @@
+/*
+ * once.h
+ *
+ * Copyright (c) agent 2026
+ *
+ * Source code released under the GPL version 2
+ *
+ */
+#ifndef ONCE_H
+#define ONCE_H
+
+#ifndef BIBL_NOTHREADS
+#include <pthread.h>
+typedef pthread_once_t bibl_once_t;
+#define BIBL_ONCE_INIT PTHREAD_ONCE_INIT
+#else
+typedef int bibl_once_t;
+#define BIBL_ONCE_INIT (0)
+#endif
+
+void bibl_once( bibl_once_t *once, void (*f)( void ) );
+void bibl_lock( void );
+void bibl_unlock( void );
+void bibl_lockwarn( void );
+void bibl_unlockwarn( void );
+
+#endif
@@ -7,31 +7,185 @@
  *
  */
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include "is_ws.h"
+#include "once.h"
+#include "strhash.h"
 #include "fields.h"
 #include "reftypes.h"
 
-int
-get_reftype( const char *p, long refnum, char *progname, variants *all, int nall, char *tag, int *is_default, int chattiness )
+/* reftypes_index
+ *
+ * Built once per variants[] table and shared by all of its entries.
+ *
+ * Types are matched as prefixes of the input, so they are chained by
+ * case-folded first character in table order; any entries with an
+ * empty type match everything and so stop the search at typeempty.
+ *
+ * Tags are found through an open-addressed hash per reftype holding
+ * the tag position plus one, zero marking an empty slot.  Only the
+ * first of several equal tags is entered, so lookups return what a
+ * scan of the tags in order would.
+ */
+struct reftypes_index {
+	short typefirst[256];
+	short *typenext;
+	int   typeempty;
+	int   *tagoff;
+	unsigned int *tagmask;
+	unsigned short *tags;
+};
+
+static unsigned int
+reftypes_hashtag( const char *p )
+{
+	return strhash_hash( p, STRHASH_NOCASE );
+}
+
+static void
+reftypes_index_free( reftypes_index *ix )
+{
+	free( ix->typenext );
+	free( ix->tagoff );
+	free( ix->tagmask );
+	free( ix->tags );
+	free( ix );
+}
+
+static reftypes_index *
+reftypes_index_new( variants all[], int nall )
+{
+	unsigned int size, h, total = 0;
+	reftypes_index *ix;
+	unsigned short *slots;
+	lookups *tags;
+	int i, j, c;
+
+	ix = ( reftypes_index * ) calloc( 1, sizeof( reftypes_index ) );
+	if ( !ix ) return NULL;
+
+	ix->typenext = ( short * ) malloc( sizeof( short ) * nall );
+	ix->tagoff   = ( int * ) malloc( sizeof( int ) * nall );
+	ix->tagmask  = ( unsigned int * ) malloc( sizeof( unsigned int ) * nall );
+	if ( !ix->typenext || !ix->tagoff || !ix->tagmask ) goto err;
+
+	for ( i=0; i<nall; ++i ) {
+		for ( size=1; size < 2 * (unsigned int) all[i].ntags; size*=2 );
+		ix->tagoff[i]  = total;
+		ix->tagmask[i] = size - 1;
+		total += size;
+	}
+
+	ix->tags = ( unsigned short * ) calloc( total, sizeof( unsigned short ) );
+	if ( !ix->tags ) goto err;
+
+	/* chain the types in table order */
+	for ( c=0; c<256; ++c )
+		ix->typefirst[c] = -1;
+	ix->typeempty = nall;
+	for ( i=nall-1; i>=0; --i ) {
+		if ( all[i].type[0]=='\0' ) {
+			ix->typeempty = i;
+			continue;
+		}
+		c = (unsigned char) tolower( (unsigned char) all[i].type[0] );
+		ix->typenext[i] = ix->typefirst[c];
+		ix->typefirst[c] = i;
+	}
+
+	for ( i=0; i<nall; ++i ) {
+		slots = ix->tags + ix->tagoff[i];
+		tags  = all[i].tags;
+		for ( j=0; j<all[i].ntags; ++j ) {
+			h = reftypes_hashtag( tags[j].oldstr ) & ix->tagmask[i];
+			while ( slots[h] ) {
+				if ( !strcasecmp( tags[ slots[h]-1 ].oldstr, tags[j].oldstr ) ) break;
+				h = ( h + 1 ) & ix->tagmask[i];
+			}
+			if ( !slots[h] ) slots[h] = j + 1;
+		}
+	}
+
+	return ix;
+err:
+	reftypes_index_free( ix );
+	return NULL;
+}
+
+/* reftypes_index_build()
+ *
+ * Called by the *_initparams() functions for their variants[] tables.
+ * The index is built on the first call and kept for the life of the
+ * program; if it cannot be allocated the lookups scan the tables.
+ */
+void
+reftypes_index_build( variants all[], int nall )
 {
+	reftypes_index *ix;
 	int i;
 
-	p = skip_ws( p );
+	if ( nall < 1 ) return;
 
-	*is_default = 0;
+	bibl_lock();
+
+	if ( !all[0].index ) {
+		ix = reftypes_index_new( all, nall );
+		if ( ix ) {
+			for ( i=0; i<nall; ++i )
+				all[i].index = ix;
+		}
+	}
+
+	bibl_unlock();
+}
+
+static int
+reftypes_findtype( const char *p, variants *all, int nall )
+{
+	reftypes_index *ix;
+	int i;
+
+	ix = ( nall > 0 ) ? all[0].index : NULL;
+
+	if ( ix ) {
+		i = ix->typefirst[ (unsigned char) tolower( (unsigned char) *p ) ];
+		for ( ; i!=-1 && i<ix->typeempty; i=ix->typenext[i] ) {
+			if ( !strncasecmp( all[i].type, p, strlen(all[i].type) ) )
+				return i;
+		}
+		if ( ix->typeempty < nall ) return ix->typeempty;
+		return -1;
+	}
 
 	for ( i=0; i<nall; ++i ) {
 		if ( !strncasecmp( all[i].type, p, strlen(all[i].type) ) ) 
 			return i;
 	}
+	return -1;
+}
+
+int
+get_reftype( const char *p, long refnum, char *progname, variants *all, int nall, char *tag, int *is_default, int chattiness )
+{
+	int i;
+
+	p = skip_ws( p );
+
+	*is_default = 0;
+
+	i = reftypes_findtype( p, all, nall );
+	if ( i!=-1 ) return i;
 
 	*is_default = 1;
 
 	if ( chattiness==REFTYPE_CHATTY ) {
+		bibl_lockwarn();
 		if ( progname ) fprintf( stderr, "%s: ", progname );
 		fprintf( stderr, "Did not recognize type '%s' of refnum %ld (%s).\n"
 			"\tDefaulting to %s.\n", p, refnum, tag, all[0].type );
+		bibl_unlockwarn();
 	}
 
 	return 0;
@@ -40,17 +194,32 @@ get_reftype( const char *p, long refnum, char *progname, variants *all, int nall
 int
 process_findoldtag( const char *oldtag, int reftype, variants all[], int nall )
 {
+        reftypes_index *ix;
+        unsigned short *slots;
+        unsigned int h;
         variants *v;
         int i;
 
         v = &(all[reftype]);
+
+        ix = v->index;
+        if ( ix ) {
+                slots = ix->tags + ix->tagoff[reftype];
+                h = reftypes_hashtag( oldtag ) & ix->tagmask[reftype];
+                while ( ( i = slots[h] ) ) {
+                        if ( !strcasecmp( (v->tags[i-1]).oldstr, oldtag ) )
+                                return i-1;
+                        h = ( h + 1 ) & ix->tagmask[reftype];
+                }
+                return -1;
+        }
+
         for ( i=0; i<v->ntags; ++i ) {
                 if ( !strcasecmp( (v->tags[i]).oldstr, oldtag ) )
                         return i;
 	}
         return -1;
 }
-
 /* translate_oldtag()
  */
 int
@@ -50,12 +50,17 @@ typedef struct {
 	int  level;
 } lookups;
 
+typedef struct reftypes_index reftypes_index;
+
 typedef struct {
 	char    type[25];
 	lookups *tags;
 	int     ntags;
+	reftypes_index *index; /* built by reftypes_index_build(), may be NULL */
 } variants;
 
+void reftypes_index_build( variants all[], int nall );
+
 int get_reftype( const char *q, long refnum, char *progname, variants *all, int nall, char *tag, int *is_default, int chattiness );
 int process_findoldtag( const char *oldtag, int reftype, variants all[], int nall );
 int translate_oldtag( const char *oldtag, int reftype, variants all[], int nall, int *processingtype, int *level, char **newtag );
@@ -19,6 +19,7 @@
 #include "utf8.h"
 #include "serialno.h"
 #include "reftypes.h"
+#include "once.h"
 #include "bibformats.h"
 #include "generic.h"
 
@@ -46,6 +47,8 @@ risin_initparams( param *pm, const char *progname )
 	pm->nosplittitle     = 0;
 	pm->verbose          = 0;
 	pm->addcount         = 0;
+	pm->stream           = 0;
+	pm->nthreads         = 0;
 	pm->output_raw       = 0;
 
 	pm->readf    = risin_readf;
@@ -55,9 +58,11 @@ risin_initparams( param *pm, const char *progname )
 	pm->convertf = risin_convertf;
 	pm->all      = ris_all;
 	pm->nall     = ris_nall;
+	reftypes_index_build( pm->all, pm->nall );
 
 	slist_init( &(pm->asis) );
 	slist_init( &(pm->corps) );
+	pm->macros = NULL;
 
 	if ( !progname ) pm->progname = NULL;
 	else {
@@ -508,8 +513,10 @@ static void
 risin_report_notag( param *p, char *tag )
 {
 	if ( p->verbose && strcmp( tag, "TY" ) ) {
+		bibl_lockwarn();
 		if ( p->progname ) fprintf( stderr, "%s: ", p->progname );
 		fprintf( stderr, "Did not identify RIS tag '%s'\n", tag );
+		bibl_unlockwarn();
 	}
 }
 
@@ -549,7 +556,11 @@ risin_convertf( fields *bibin, fields *bibout, int reftype, param *p )
 
 	if ( status == BIBL_OK ) status = risin_thesis_hints( bibin, reftype, p, bibout );
 
-	if ( status==BIBL_OK && p->verbose ) fields_report( bibout, stderr );
+	if ( status==BIBL_OK && p->verbose ) {
+		bibl_lockwarn();
+		fields_report( bibout, stderr );
+		bibl_unlockwarn();
+	}
 
 	return status;
 }
@@ -17,6 +17,7 @@
 #include "title.h"
 #include "url.h"
 #include "utf8.h"
+#include "once.h"
 
 /*****************************************************
  PUBLIC: int risout_initparams()
@@ -39,6 +40,8 @@ risout_initparams( param *pm, const char *progname )
 	pm->nosplittitle     = 0;
 	pm->verbose          = 0;
 	pm->addcount         = 0;
+	pm->stream           = 0;
+	pm->nthreads         = 0;
 	pm->singlerefperfile = 0;
 
 	if ( pm->charsetout == BIBL_CHARSET_UNICODE ) {
@@ -154,19 +157,23 @@ write_type( FILE *fp, int type )
 static void
 verbose_type_identified( char *element_type, param *p, int type )
 {
+	bibl_lockwarn();
 	if ( p->progname ) fprintf( stderr, "%s: ", p->progname );
 	fprintf( stderr, "Type from %s element: ", element_type );
 	write_type( stderr, type );
 	fprintf( stderr, "\n" );
+	bibl_unlockwarn();
 }
 
 static void
 verbose_type_assignment( char *tag, char *value, param *p, int type )
 {
+	bibl_lockwarn();
 	if ( p->progname ) fprintf( stderr, "%s: ", p->progname );
 	fprintf( stderr, "Type from tag '%s' value '%s': ", tag, value );
 	write_type( stderr, type );
 	fprintf( stderr, "\n" );
+	bibl_unlockwarn();
 }
 
 typedef struct match_type {
@@ -299,10 +306,12 @@ get_type_issuance( fields *f, param *p )
 	}
 
 	if ( p->verbose ) {
+		bibl_lockwarn();
 		if ( p->progname ) fprintf( stderr, "%s: ", p->progname );
 		fprintf( stderr, "Type from issuance/typeOfReference elements: " );
 		write_type( stderr, type );
 		fprintf( stderr, "\n" );
+		bibl_unlockwarn();
 	}
 
 	return type;
@@ -321,10 +330,12 @@ get_type( fields *f, param *p )
 	}
 
 	if ( p->verbose ) {
+		bibl_lockwarn();
 		if ( p->progname ) fprintf( stderr, "%s: ", p->progname );
 		fprintf( stderr, "Final type: " );
 		write_type( stderr, type );
 		fprintf( stderr, "\n" );
+		bibl_unlockwarn();
 	}
 
 
@@ -365,8 +376,10 @@ append_type( int type, param *p, fields *out, int *status )
 	int fstatus;
 
 	if ( type < 0 || type >= NUM_TYPES ) {
+		bibl_lockwarn();
 		if ( p->progname ) fprintf( stderr, "%s: ", p->progname );
 		fprintf( stderr, "Internal error: Cannot recognize type %d, switching to TYPE_STD %d\n", type, TYPE_STD );
+		bibl_unlockwarn();
 		type = TYPE_STD;
 	}
 
@@ -707,6 +720,5 @@ risout_write( fields *out, FILE *fp, param *p, unsigned long refnum )
 	}
 
 	fprintf( fp, "ER  - \n" );
-	fflush( fp );
 	return BIBL_OK;
 }
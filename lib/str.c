@@ -680,13 +680,16 @@ str_findreplace( str *s, const char *find, const char *replace )
 int
 str_fget( FILE *fp, char *buf, int bufsize, int *pbufpos, str *outs )
 {
-	int  bufpos = *pbufpos, done = 0;
+	int  bufpos = *pbufpos, done = 0, n;
 	char *ok;
 	assert( fp && outs );
 	str_empty( outs );
 	while ( !done ) {
-		while ( buf[bufpos] && buf[bufpos]!='\r' && buf[bufpos]!='\n' )
-			str_addchar( outs, buf[bufpos++] );
+		n = strcspn( &(buf[bufpos]), "\r\n" );
+		if ( n ) {
+			str_strcat_internal( outs, &(buf[bufpos]), n );
+			bufpos += n;
+		}
 		if ( buf[bufpos]=='\0' ) {
 			ok = fgets( buf, bufsize, fp );
 			bufpos=*pbufpos=0;
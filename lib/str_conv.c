@@ -19,6 +19,7 @@
 #include "gb18030.h"
 #include "charsets.h"
 #include "str_conv.h"
+#include "once.h"
 
 static void
 addentity( str *s, unsigned int ch )
@@ -81,16 +82,20 @@ addgb18030char( str *s, unsigned int ch, int xmlout )
 static void
 addlatexchar( str *s, unsigned int ch, int xmlout, int utf8out )
 {
+	const char *p;
 	char buf[512];
-	uni2latex( ch, buf, sizeof( buf ) );
+	p = uni2latex_str( ch, buf, sizeof( buf ) );
 	/* If the unicode character isn't recognized as latex output
 	 * a '?' unless the user has requested unicode output.  If so,
 	 * output the unicode.
 	 */
-	if ( utf8out && !strcmp( buf, "?" ) ) {
-		addutf8char( s, ch, xmlout );
+	if ( !p ) {
+		if ( utf8out ) addutf8char( s, ch, xmlout );
+		else str_addchar( s, '?' );
+	} else if ( p[0] && !p[1] ) {
+		str_addchar( s, p[0] );
 	} else {
-		str_strcatc( s, buf );
+		str_strcatc( s, p );
 	}
 }
 
@@ -161,6 +166,110 @@ write_unicode( str *s, unsigned int ch, int charsetout, int latexout,
 	return 1;
 }
 
+/*
+ * ASCII pass-through
+ *
+ * Under most conversions the bulk of a string is ASCII that comes out
+ * unchanged.  Characters that might not are flagged in 128-bit masks,
+ * one per transformation; str_convert() combines those that apply and
+ * copies runs of unflagged characters straight across, returning early
+ * without touching the string if it is all such characters.  From UTF-8
+ * to UTF-8, well-formed multibyte characters pass through as well.
+ */
+#define STR_CONV_MASKWORDS ( 128 / 32 )
+
+static unsigned int str_conv_xmlin[ STR_CONV_MASKWORDS ];
+static unsigned int str_conv_xmlout[ STR_CONV_MASKWORDS ];
+static unsigned int str_conv_latexin[ STR_CONV_MASKWORDS ];
+static unsigned int str_conv_latexout[ STR_CONV_MASKWORDS ];
+
+static void
+str_conv_setmask( unsigned int mask[], unsigned char c )
+{
+	mask[ c / 32 ] |= ( 1U << ( c % 32 ) );
+}
+
+static int
+str_conv_inmask( const unsigned int mask[], unsigned char c )
+{
+	return ( mask[ c / 32 ] >> ( c % 32 ) ) & 1U;
+}
+
+static void
+str_conv_buildmasks( void )
+{
+	const char *p;
+	char buf[512];
+	unsigned int c;
+
+	str_conv_setmask( str_conv_xmlin, '&' );
+
+	for ( p="\"&'<>"; *p; ++p )
+		str_conv_setmask( str_conv_xmlout, *p );
+
+	for ( c=1; c<128; ++c ) {
+		if ( latex2char_special( c ) )
+			str_conv_setmask( str_conv_latexin, c );
+		p = uni2latex_str( c, buf, sizeof( buf ) );
+		if ( !p || p[0]!=(char) c || p[1]!='\0' )
+			str_conv_setmask( str_conv_latexout, c );
+	}
+}
+
+static bibl_once_t str_conv_masks_once = BIBL_ONCE_INIT;
+
+/* str_conv_asciimask()
+ *
+ * Fill mask with the ASCII characters the conversion may change,
+ * returning 0 if the charsets themselves do not pass ASCII through.
+ */
+static int
+str_conv_asciimask( unsigned int mask[],
+	int charsetin,  int latexin,  int xmlin,
+	int charsetout, int latexout, int utf8out, int xmlout )
+{
+	int i;
+
+	if ( !charset_isascii( charsetin ) ) return 0;
+	if ( !latexout && !utf8out && !charset_isascii( charsetout ) ) return 0;
+
+	bibl_once( &str_conv_masks_once, str_conv_buildmasks );
+
+	for ( i=0; i<STR_CONV_MASKWORDS; ++i ) {
+		mask[i] = 0;
+		if ( xmlin ) mask[i] |= str_conv_xmlin[i];
+		if ( latexin && charsetin!=CHARSET_GB18030 ) mask[i] |= str_conv_latexin[i];
+		if ( latexout ) mask[i] |= str_conv_latexout[i];
+		else if ( xmlout ) mask[i] |= str_conv_xmlout[i];
+	}
+	str_conv_setmask( mask, '\0' );  /* runs stop at the end of the string */
+
+	return 1;
+}
+
+/* str_conv_run()
+ *
+ * Return the number of bytes at the start of p (of length len) that
+ * pass through unchanged: ASCII characters not in mask and, within the
+ * first valid bytes, which utf8_valid_span() found to be well-formed
+ * UTF-8, the multibyte characters as well.
+ */
+static unsigned long
+str_conv_run( const char *p, unsigned long len, const unsigned int mask[], unsigned long valid )
+{
+	const unsigned char *q = ( const unsigned char * ) p;
+	unsigned long n = 0;
+
+	while ( n < len ) {
+		if ( q[n] < 128 ) {
+			if ( str_conv_inmask( mask, q[n] ) ) break;
+		} else if ( n >= valid ) break;
+		n++;
+	}
+
+	return n;
+}
+
 /*
  * Returns 1 on memory error condition
  */
@@ -169,13 +278,35 @@ str_convert( str *s,
 	int charsetin,  int latexin,  int utf8in,  int xmlin,
 	int charsetout, int latexout, int utf8out, int xmlout )
 {
+	unsigned int mask[ STR_CONV_MASKWORDS ];
 	unsigned int pos = 0;
+	unsigned long n = 0, valid = 0;
 	unsigned int ch;
+	int ascii, utf8pass;
 	str ns;
 	int ok = 1;
 
 	if ( !s || s->len==0 ) return ok;
 
+	if ( charsetin==CHARSET_UNKNOWN ) charsetin = CHARSET_DEFAULT;
+	if ( charsetout==CHARSET_UNKNOWN ) charsetout = CHARSET_DEFAULT;
+
+	ascii = str_conv_asciimask( mask, charsetin, latexin, xmlin,
+			charsetout, latexout, utf8out, xmlout );
+
+	/* UTF-8 to UTF-8 without LaTeX or entities on output */
+	utf8pass = ( utf8in && utf8out && !latexout &&
+		xmlout!=STR_CONV_XMLOUT_ENTITIES &&
+		charsetin!=CHARSET_GB18030 &&
+		( latexin || charsetin==CHARSET_UNICODE ) );
+
+	/* Nothing to do if the whole string passes through unchanged */
+	if ( ascii ) {
+		if ( utf8pass ) valid = utf8_valid_span( s->data, s->len );
+		n = str_conv_run( s->data, s->len, mask, valid );
+		if ( n==s->len ) return ok;
+	}
+
 	/* Ensure that string is internally allocated.
 	 * This fixes NULL pointer derefernce in CVE-2018-10775 in bibutils
 	 * as a string with a valid data pointer is potentially replaced
@@ -187,13 +318,25 @@ str_convert( str *s,
 	 */
 	str_initstrc( &ns, "" );
 
-	if ( charsetin==CHARSET_UNKNOWN ) charsetin = CHARSET_DEFAULT;
-	if ( charsetout==CHARSET_UNKNOWN ) charsetout = CHARSET_DEFAULT;
+	if ( n ) {
+		str_segcat( &ns, s->data, s->data + n );
+		pos = n;
+	}
 
 	while ( s->data[pos] ) {
 		ch = get_unicode( s, &pos, charsetin, latexin, utf8in, xmlin );
 		ok = write_unicode( &ns, ch, charsetout, latexout, utf8out, xmlout );
 		if ( !ok ) goto out;
+		if ( ascii && pos < s->len ) {
+			/* past a malformed character, find how far the next stretch of valid UTF-8 runs */
+			if ( utf8pass && pos > valid )
+				valid = pos + utf8_valid_span( &(s->data[pos]), s->len - pos );
+			n = str_conv_run( &(s->data[pos]), s->len - pos, mask, ( valid > pos ) ? valid - pos : 0 );
+			if ( n ) {
+				str_segcat( &ns, &(s->data[pos]), &(s->data[pos+n]) );
+				pos += n;
+			}
+		}
 	}
 
 	str_swapstrings( s, &ns );
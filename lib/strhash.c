@@ -0,0 +1,203 @@
+/*
+ * strhash.c
+ *
+ * Copyright (c) agent 2026
+ *
+ * Source code released under the GPL version 2
+ *
+ * Implements a hashed index over a list of strings.  Each key is
+ * identified by its position in the order it was added, so callers
+ * can keep values for the keys in a parallel intlist/slist/vplist.
+ *
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "strhash.h"
+
+/* Do not use asserts in STRHASH_NOASSERT defined */
+#ifdef STRHASH_NOASSERT
+#define NDEBUG
+#endif
+#include <assert.h>
+
+#define STRHASH_MINSLOTS (64)
+
+void
+strhash_init( strhash *h, int mode )
+{
+	assert( h );
+
+	slist_init( &(h->keys) );
+	h->slots  = NULL;
+	h->nslots = 0;
+	h->nocase = ( mode==STRHASH_NOCASE );
+}
+
+void
+strhash_free( strhash *h )
+{
+	assert( h );
+
+	slist_free( &(h->keys) );
+	if ( h->slots ) free( h->slots );
+	h->slots  = NULL;
+	h->nslots = 0;
+}
+
+void
+strhash_empty( strhash *h )
+{
+	int i;
+
+	assert( h );
+
+	slist_empty( &(h->keys) );
+	for ( i=0; i<h->nslots; ++i )
+		h->slots[i] = -1;
+}
+
+/* strhash_hashn()
+ *
+ * FNV-1a over the first len bytes of key, or up to its terminating
+ * '\0' if len is negative, folding case for STRHASH_NOCASE.  Shared by
+ * the other tables in the library that hash strings.
+ */
+unsigned int
+strhash_hashn( const char *key, int len, int mode )
+{
+	const unsigned char *p = ( const unsigned char * ) key;
+	unsigned int hash = 2166136261U;
+	int i;
+
+	if ( !p ) return hash;
+
+	for ( i=0; ( len<0 ) ? ( p[i]!='\0' ) : ( i<len ); ++i ) {
+		if ( mode==STRHASH_NOCASE ) hash ^= ( unsigned int ) toupper( p[i] );
+		else hash ^= ( unsigned int ) p[i];
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+unsigned int
+strhash_hash( const char *key, int mode )
+{
+	return strhash_hashn( key, -1, mode );
+}
+
+static int
+strhash_matches( strhash *h, int n, const char *key )
+{
+	if ( h->nocase ) return !strcasecmp( slist_cstr( &(h->keys), n ), key );
+	else return !strcmp( slist_cstr( &(h->keys), n ), key );
+}
+
+/* strhash_slot()
+ *
+ * Returns the slot holding key, or the empty slot where it belongs.
+ */
+static int
+strhash_slot( strhash *h, const char *key )
+{
+	unsigned int mask = h->nslots - 1;
+	unsigned int i;
+
+	i = strhash_hash( key, ( h->nocase ) ? STRHASH_NOCASE : STRHASH_CASE ) & mask;
+	while ( h->slots[i]!=-1 && !strhash_matches( h, h->slots[i], key ) )
+		i = ( i + 1 ) & mask;
+
+	return ( int ) i;
+}
+
+/* strhash_resize()
+ *
+ * Number of slots is kept a power of two at least twice the number
+ * of keys so probe sequences stay short.
+ */
+static int
+strhash_resize( strhash *h, int nslots )
+{
+	int i, *old = h->slots;
+
+	h->slots = ( int * ) malloc( sizeof( int ) * nslots );
+	if ( !h->slots ) {
+		h->slots = old;
+		return STRHASH_ERR_MEMERR;
+	}
+	h->nslots = nslots;
+
+	for ( i=0; i<nslots; ++i )
+		h->slots[i] = -1;
+
+	for ( i=0; i<h->keys.n; ++i )
+		h->slots[ strhash_slot( h, slist_cstr( &(h->keys), i ) ) ] = i;
+
+	if ( old ) free( old );
+
+	return STRHASH_OK;
+}
+
+/* strhash_find()
+ *
+ * Returns position of key, or STRHASH_NOTFOUND
+ */
+int
+strhash_find( strhash *h, const char *key )
+{
+	assert( h );
+	assert( key );
+
+	if ( h->nslots==0 ) return STRHASH_NOTFOUND;
+
+	return h->slots[ strhash_slot( h, key ) ];
+}
+
+/* strhash_add()
+ *
+ * Adds key if it is not already present.  Either way *n is set to
+ * the position of the key.
+ *
+ * Returns STRHASH_OK or STRHASH_ERR_MEMERR
+ */
+int
+strhash_add( strhash *h, const char *key, int *n )
+{
+	int slot, status;
+
+	assert( h );
+	assert( key );
+
+	if ( 2 * ( h->keys.n + 1 ) > h->nslots ) {
+		status = strhash_resize( h, ( h->nslots ) ? h->nslots * 2 : STRHASH_MINSLOTS );
+		if ( status!=STRHASH_OK ) return status;
+	}
+
+	slot = strhash_slot( h, key );
+	if ( h->slots[slot]==-1 ) {
+		status = slist_addc( &(h->keys), key );
+		if ( status!=SLIST_OK ) return STRHASH_ERR_MEMERR;
+		h->slots[slot] = h->keys.n - 1;
+	}
+
+	if ( n ) *n = h->slots[slot];
+
+	return STRHASH_OK;
+}
+
+int
+strhash_num( strhash *h )
+{
+	assert( h );
+
+	return h->keys.n;
+}
+
+char *
+strhash_key( strhash *h, int n )
+{
+	assert( h );
+
+	return slist_cstr( &(h->keys), n );
+}
@@ -0,0 +1,42 @@
+/*
+ * strhash.h
+ *
+ * Copyright (c) agent 2026
+ *
+ * Source code released under the GPL version 2
+ *
+ */
+#ifndef STRHASH_H
+#define STRHASH_H
+
+#include "slist.h"
+
+#define STRHASH_OK          (0)
+#define STRHASH_ERR_MEMERR (-1)
+
+#define STRHASH_NOTFOUND   (-1)
+
+#define STRHASH_CASE   (0)
+#define STRHASH_NOCASE (1)
+
+typedef struct strhash {
+	slist keys;     /* keys in the order they were added */
+	int  *slots;    /* position in keys, or -1 if empty */
+	int   nslots;
+	int   nocase;
+} strhash;
+
+void  strhash_init( strhash *h, int mode );
+void  strhash_free( strhash *h );
+void  strhash_empty( strhash *h );
+
+int   strhash_find( strhash *h, const char *key );
+int   strhash_add( strhash *h, const char *key, int *n );
+
+unsigned int strhash_hash( const char *key, int mode );
+unsigned int strhash_hashn( const char *key, int len, int mode );
+
+int   strhash_num( strhash *h );
+char *strhash_key( strhash *h, int n );
+
+#endif
@@ -15,27 +15,118 @@
  * strsearch returns haystack when needle is empty as per strstr()
  * conventions
  *
+ * Candidates are found by scanning for either case of the needle's
+ * first character (sixteen bytes at a time where SSE2 is available)
+ * and only those positions are compared against the rest of the needle.
+ *
  */
 #include <stdio.h>
+#include <stdint.h>
 #include <ctype.h>
 #include "strsearch.h"
 
-char *strsearch (const char *haystack, const char *needle)
+#if defined(__SSE2__) && !defined(STRSEARCH_NOSIMD)
+#include <emmintrin.h>
+
+/* Aligned sixteen-byte loads never cross a page boundary, so reading
+ * past the terminating '\0' within the block is safe, but it does look
+ * like an overrun to AddressSanitizer.
+ */
+#if defined(__SANITIZE_ADDRESS__)
+#define STRSEARCH_NOASAN __attribute__((no_sanitize_address))
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define STRSEARCH_NOASAN __attribute__((no_sanitize_address))
+#endif
+#endif
+#ifndef STRSEARCH_NOASAN
+#define STRSEARCH_NOASAN
+#endif
+
+/* strsearch_first()
+ *
+ * Return pointer to first character in p equal to a or b, NULL if the
+ * end of the string is reached first.
+ */
+STRSEARCH_NOASAN
+static const char *
+strsearch_first( const char *p, unsigned char a, unsigned char b )
+{
+	uintptr_t off = (uintptr_t) p & 15;
+	const __m128i *q = (const __m128i *)( p - off );
+	const __m128i va = _mm_set1_epi8( (char) a );
+	const __m128i vb = _mm_set1_epi8( (char) b );
+	const __m128i zero = _mm_setzero_si128();
+	unsigned int mask;
+	__m128i v;
+
+	v = _mm_load_si128( q );
+	mask = _mm_movemask_epi8( _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( v, va ),
+		_mm_cmpeq_epi8( v, vb ) ), _mm_cmpeq_epi8( v, zero ) ) );
+	mask &= ( 0xffffU << off ) & 0xffffU;
+
+	while ( !mask ) {
+		q++;
+		v = _mm_load_si128( q );
+		mask = _mm_movemask_epi8( _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( v, va ),
+			_mm_cmpeq_epi8( v, vb ) ), _mm_cmpeq_epi8( v, zero ) ) );
+	}
+
+	p = (const char *) q;
+	while ( !( mask & 1 ) ) {
+		mask >>= 1;
+		p++;
+	}
+
+	if ( *p=='\0' ) return NULL;
+	return p;
+}
+
+#else
+
+static const char *
+strsearch_first( const char *p, unsigned char a, unsigned char b )
+{
+	while ( *p ) {
+		if ( (unsigned char) *p==a || (unsigned char) *p==b ) return p;
+		p++;
+	}
+	return NULL;
+}
+
+#endif
+
+/* strsearch_rest()
+ *
+ * Return 1 if the remainder of needle matches the start of p.
+ */
+static int
+strsearch_rest( const char *p, const char *needle )
 {
-	char *returnptr=NULL;
-	unsigned long pos=0;
-
-	if ( !(*needle) ) returnptr = (char *) haystack;
-
-	while (*(haystack+pos) && returnptr==NULL) {
-		if ( toupper((unsigned char)*(haystack+pos)) == toupper((unsigned char)*(needle+pos)) )
-			pos++;
-		else {
-			pos = 0;
-			haystack++;
-		}
-		if ( ! (*(needle+pos)) ) returnptr = (char *) haystack;
+	while ( *needle ) {
+		if ( !*p ) return 0;
+		if ( toupper((unsigned char)*p) != toupper((unsigned char)*needle) ) return 0;
+		p++;
+		needle++;
 	}
-	return returnptr;
+	return 1;
 }
 
+char *strsearch (const char *haystack, const char *needle)
+{
+	unsigned char up, lo;
+	const char *p;
+
+	if ( !(*needle) ) return (char *) haystack;
+
+	up = toupper( (unsigned char) *needle );
+	lo = tolower( (unsigned char) *needle );
+
+	p = strsearch_first( haystack, up, lo );
+	while ( p ) {
+		if ( strsearch_rest( p+1, needle+1 ) ) return (char *) p;
+		p = strsearch_first( p+1, up, lo );
+	}
+
+	return NULL;
+}
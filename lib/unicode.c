@@ -299,30 +299,52 @@ unicode_find( unsigned int unicode_character )
 		else
 			max = mid;
 	}
-	if ( ( max==min ) && ( unicodeinfo[min].value == unicode_character ) )
+	if ( min < nunicodeinfo && unicodeinfo[min].value == unicode_character )
 		return min;
 	else
 		return -1;
 }
 
+/* ASCII entries in unicodeinfo[] are just the digits and letters */
+static unsigned short
+unicode_classify_ascii( unsigned char c )
+{
+	if ( c>='0' && c<='9' ) return UNICODE_NUMBER;
+	if ( c>='A' && c<='Z' ) return UNICODE_UPPER;
+	if ( c>='a' && c<='z' ) return UNICODE_LOWER;
+	return UNICODE_SYMBOL;
+}
+
 unsigned short
 unicode_utf8_classify( char *p )
 {
 	unsigned int unicode_character, pos = 0;
 	int n;
+	if ( !( *p & 0x80 ) ) return unicode_classify_ascii( (unsigned char) *p );
 	unicode_character = utf8_decode( p, &pos );
 	n = unicode_find( unicode_character );
 	if ( n==-1 ) return UNICODE_SYMBOL;
 	else return unicodeinfo[n].info;
 }
 
+/* unicode_utf8_classify_str()
+ *
+ * ASCII runs are classified without decoding, and the scan stops once
+ * every class has been seen.
+ */
 unsigned short
 unicode_utf8_classify_str( str *s )
 {
+	const unsigned short all = UNICODE_SYMBOL | UNICODE_UPPER | UNICODE_LOWER | UNICODE_NUMBER;
 	unsigned int unicode_character, pos = 0;
 	unsigned short value = 0;
+	unsigned long end;
 	int n;
-	while ( pos < s->len ) {
+	while ( pos < s->len && value!=all ) {
+		end = pos + utf8_ascii_span( &(s->data[pos]), s->len - pos );
+		while ( pos < end )
+			value |= unicode_classify_ascii( (unsigned char) s->data[pos++] );
+		if ( pos >= s->len ) break;
 		unicode_character = utf8_decode( str_cstr( s ), &pos );
 		n = unicode_find( unicode_character );
 		if ( n==-1 ) value |= UNICODE_SYMBOL;
@@ -330,4 +352,3 @@ unicode_utf8_classify_str( str *s )
 	}
 	return value;
 }
-
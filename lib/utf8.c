@@ -8,6 +8,9 @@
  */
 #include <stdio.h>
 #include <string.h>
+#if defined(__SSE2__) && !defined(UTF8_NOSIMD)
+#include <emmintrin.h>
+#endif
 #include "utf8.h"
 
 /* UTF-8 encoding
@@ -21,24 +24,6 @@ U-04000000 - U-7FFFFFFF:  1111110x 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx
 
 */
 
-static void
-utf8_build( unsigned int value, unsigned char out[6], int in_pos, int out_pos )
-{
-	unsigned int in_mask, out_mask;
-	int byte = 0;
-	while ( in_pos < 32 ) {
-		in_mask = 1 << ( 31 - in_pos );
-		out_mask = 1 << ( 7 - out_pos );
-		if ( value & in_mask ) out[byte] |= out_mask;
-		in_pos++;
-		out_pos++;
-		if ( out_pos > 7 ) {
-			out_pos=2;
-			byte++;
-		}
-	}
-}
-
 /* int utf8( in, out[6] );
  *
  *  in is character code 0x0 -> 0x7FFFFFFF
@@ -48,36 +33,32 @@ utf8_build( unsigned int value, unsigned char out[6], int in_pos, int out_pos )
 int
 utf8_encode( unsigned int value, unsigned char out[6] )
 {
-	int i;
-	for ( i=1; i<6; ++i ) out[i] = 0x80;  /* 10xxxxxx */
+	int i, n;
 	if ( value < 0x80 ) {
-		out[0] = 0x0;   /* 0xxxxxxx */
-		utf8_build( value, out, 25, 1 );
+		out[0] = value;                 /* 0xxxxxxx */
 		return 1;
 	} else if ( value < 0x800 ) {
-		out[0] = 0xC0;  /* 110xxxxx */
-		utf8_build( value, out, 21, 3 );
-		return 2;
+		out[0] = 0xC0 | ( value >> 6 );  /* 110xxxxx */
+		n = 2;
 	} else if ( value < 0x10000 ) {
-		out[0] = 0xE0;  /* 1110xxxx */
-		utf8_build( value, out, 16, 4 );
-		return 3;
+		out[0] = 0xE0 | ( value >> 12 ); /* 1110xxxx */
+		n = 3;
 	} else if ( value < 0x200000 ) {
-		out[0] = 0xF0;  /* 11110xxx */
-		utf8_build( value, out, 11, 5 );
-		return 4;
+		out[0] = 0xF0 | ( value >> 18 ); /* 11110xxx */
+		n = 4;
 	} else if ( value < 0x4000000 ) {
-		out[0] = 0xF8;  /* 111110xx */
-		utf8_build( value, out,  6, 6 );
-		return 5;
+		out[0] = 0xF8 | ( value >> 24 ); /* 111110xx */
+		n = 5;
 	} else if ( value < (unsigned int ) 0x80000000 ) {
-		out[0] = 0xFC;  /* 1111110x */
-		utf8_build( value, out,  1, 7 );
-		return 6;
+		out[0] = 0xFC | ( value >> 30 ); /* 1111110x */
+		n = 6;
 	} else {
 		/* error, above 2^31 bits encodable by UTF-8 */
 		return 0;
 	}
+	for ( i=1; i<n; ++i )
+		out[i] = 0x80 | ( ( value >> ( 6 * ( n-1-i ) ) ) & 0x3F );  /* 10xxxxxx */
+	return n;
 }
 
 /* Generate UTF8 character as null-terminated string */
@@ -139,6 +120,168 @@ utf8_decode( const char *s, unsigned int *pi )
 	return c;
 }
 
+/* utf8_ascii_span()
+ *
+ * Return the number of bytes at the start of s (of length len) that
+ * are seven-bit ASCII, checking sixteen at a time where SSE2 is
+ * available.
+ */
+unsigned long
+utf8_ascii_span( const char *s, unsigned long len )
+{
+	unsigned long n = 0;
+#if defined(__SSE2__) && !defined(UTF8_NOSIMD)
+	while ( n + 16 <= len ) {
+		if ( _mm_movemask_epi8( _mm_loadu_si128( (const __m128i *) &(s[n]) ) ) ) break;
+		n += 16;
+	}
+#endif
+	while ( n < len && !( s[n] & 0x80 ) ) n++;
+	return n;
+}
+
+/* utf8_char_valid()
+ *
+ * Return the length of the UTF-8 character at the start of s (of
+ * length len) if it is well-formed and in its shortest form, i.e. if
+ * utf8_decode() followed by utf8_encode() reproduces it exactly, or
+ * zero if it is not.
+ */
+int
+utf8_char_valid( const char *s, unsigned long len )
+{
+	static const unsigned int minvalue[7] = { 0, 0, 0x80, 0x800, 0x10000, 0x200000, 0x4000000 };
+	const unsigned char *p = ( const unsigned char * ) s;
+	unsigned int value;
+	int i, n;
+
+	if ( len==0 ) return 0;
+
+	if      ( p[0] < 0x80 )           return 1;
+	else if ( ( p[0] & 0xE0 )==0xC0 ) { n = 2; value = p[0] & 0x1F; }
+	else if ( ( p[0] & 0xF0 )==0xE0 ) { n = 3; value = p[0] & 0x0F; }
+	else if ( ( p[0] & 0xF8 )==0xF0 ) { n = 4; value = p[0] & 0x07; }
+	else if ( ( p[0] & 0xFC )==0xF8 ) { n = 5; value = p[0] & 0x03; }
+	else if ( ( p[0] & 0xFE )==0xFC ) { n = 6; value = p[0] & 0x01; }
+	else return 0;
+
+	if ( (unsigned long) n > len ) return 0;
+
+	for ( i=1; i<n; ++i ) {
+		if ( ( p[i] & 0xC0 )!=0x80 ) return 0;
+		value = ( value << 6 ) | ( p[i] & 0x3F );
+	}
+
+	if ( value < minvalue[n] ) return 0;
+
+	return n;
+}
+
+#if defined(__SSE2__) && !defined(UTF8_NOSIMD)
+/* Byte values for utf8_valid16(), set up once per utf8_valid_span() */
+typedef struct utf8_bytes16 {
+	__m128i x80, xc0, xe0, xf0, xf8, xfe;
+} utf8_bytes16;
+
+static void
+utf8_bytes16_init( utf8_bytes16 *k )
+{
+	k->x80 = _mm_set1_epi8( (char) 0x80 );
+	k->xc0 = _mm_set1_epi8( (char) 0xC0 );
+	k->xe0 = _mm_set1_epi8( (char) 0xE0 );
+	k->xf0 = _mm_set1_epi8( (char) 0xF0 );
+	k->xf8 = _mm_set1_epi8( (char) 0xF8 );
+	k->xfe = _mm_set1_epi8( (char) 0xFE );
+}
+
+/* bit i set if byte i of v, masked with bits, equals value */
+#define utf8_mask16( v, bits, value ) \
+	( (unsigned int) _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_and_si128( (v), (bits) ), (value) ) ) )
+
+/* utf8_valid16()
+ *
+ * Check the sixteen bytes at s, which must be followed by at least one
+ * more, for characters of up to four bytes that utf8_char_valid() would
+ * accept.  *carry holds the continuation bytes still owed by a character
+ * started in the previous block and is updated for the next.  Return the
+ * offset of the last character boundary in the block, or -1 if anything
+ * is not accepted (including five- and six-byte forms, left to the
+ * caller).
+ */
+static int
+utf8_valid16( const char *s, unsigned int *carry, const utf8_bytes16 *k )
+{
+	__m128i v    = _mm_loadu_si128( (const __m128i *) s );
+	__m128i next = _mm_loadu_si128( (const __m128i *) ( s + 1 ) );
+	unsigned int high, cont, lead2, lead3, lead4, leads, owed;
+	int i;
+
+	high = _mm_movemask_epi8( v );
+	if ( !high && !*carry ) return 16;
+
+	cont  = utf8_mask16( v, k->xc0, k->x80 );
+	lead2 = utf8_mask16( v, k->xe0, k->xc0 );
+	lead3 = utf8_mask16( v, k->xf0, k->xe0 );
+	lead4 = utf8_mask16( v, k->xf8, k->xf0 );
+	leads = lead2 | lead3 | lead4;
+
+	if ( ( cont | leads )!=high ) return -1;
+
+	/* continuation bytes must be exactly where the leads call for them */
+	owed = *carry | ( leads << 1 ) | ( ( lead3 | lead4 ) << 2 ) | ( lead4 << 3 );
+	if ( ( owed & 0xFFFF )!=cont ) return -1;
+
+	/* shortest form only: no C0 or C1, no E0 80-9F, no F0 80-8F */
+	if ( lead2 && utf8_mask16( v, k->xfe, k->xc0 ) ) return -1;
+	if ( lead3 && ( _mm_movemask_epi8( _mm_cmpeq_epi8( v, k->xe0 ) ) & utf8_mask16( next, k->xe0, k->x80 ) ) ) return -1;
+	if ( lead4 && ( _mm_movemask_epi8( _mm_cmpeq_epi8( v, k->xf0 ) ) & utf8_mask16( next, k->xf0, k->x80 ) ) ) return -1;
+
+	*carry = owed >> 16;
+	if ( !*carry ) return 16;
+
+	/* the character running into the next block starts at the last lead */
+	for ( i=15; !( leads & ( 1U << i ) ); --i )
+		;
+	return i;
+}
+#endif
+
+/* utf8_valid_span()
+ *
+ * Return the number of bytes at the start of s (of length len) that
+ * are valid UTF-8 in the sense of utf8_char_valid(); len if all are.
+ * Where SSE2 is available sixteen bytes are checked at a time and the
+ * rest, or anything the block check does not accept, a character at a
+ * time.
+ */
+unsigned long
+utf8_valid_span( const char *s, unsigned long len )
+{
+	unsigned long n = 0;
+	int nc;
+#if defined(__SSE2__) && !defined(UTF8_NOSIMD)
+	unsigned long start = 0;
+	unsigned int carry = 0;
+	utf8_bytes16 k;
+
+	utf8_bytes16_init( &k );
+	while ( n + 17 <= len ) {
+		nc = utf8_valid16( &(s[n]), &carry, &k );
+		if ( nc < 0 ) break;
+		start = n + nc;
+		n += 16;
+	}
+	n = start;
+#endif
+	while ( n < len ) {
+		nc = utf8_char_valid( &(s[n]), len-n );
+		if ( !nc ) break;
+		n += nc;
+	}
+
+	return n;
+}
+
 void
 utf8_writebom( FILE *outptr )
 {
@@ -36,6 +36,8 @@ wordin_initparams( param *pm, const char *progname )
 	pm->nosplittitle     = 0;
 	pm->verbose          = 0;
 	pm->addcount         = 0;
+	pm->stream           = 0;
+	pm->nthreads         = 0;
 	pm->output_raw       = BIBL_RAW_WITHMAKEREFID |
 	                      BIBL_RAW_WITHCHARCONVERT;
 
@@ -49,6 +51,7 @@ wordin_initparams( param *pm, const char *progname )
 
 	slist_init( &(pm->asis) );
 	slist_init( &(pm->corps) );
+	pm->macros = NULL;
 
 	if ( !progname ) pm->progname = NULL;
 	else {
@@ -70,9 +73,9 @@ wordin_findstartwrapper( char *buf, int *ntype )
 }
 
 static char *
-wordin_findendwrapper( char *buf, int ntype )
+wordin_findendwrapper( str *s, int ntype, unsigned long *scanned )
 {
-	return xml_find_end( buf, "b:Source" );
+	return xml_find_end_more( s, "b:Source", scanned );
 }
 
 static int
@@ -80,12 +83,14 @@ wordin_readf( FILE *fp, char *buf, int bufsize, int *bufpos, str *line, str *ref
 {
 	str tmp;
 	char *startptr = NULL, *endptr;
-	int haveref = 0, inref = 0, file_charset = CHARSET_UNKNOWN, m, type = 1;
+	int haveref = 0, inref = 0, file_charset = CHARSET_UNKNOWN, type = 1;
+	int sniff = ( *bufpos==0 && buf[0]=='\0' ); /* at start of stream */
+	unsigned long scanned = 0;
 	str_init( &tmp );
 	while ( !haveref && str_fget( fp, buf, bufsize, bufpos, line ) ) {
-		if ( str_cstr( line ) ) {
-			m = xml_getencoding( line );
-			if ( m!=CHARSET_UNKNOWN ) file_charset = m;
+		if ( sniff && str_has_value( line ) && *skip_ws( str_cstr( line ) ) ) {
+			file_charset = xml_getencoding( str_cstr( line ) );
+			sniff = 0;
 		}
 		if ( str_cstr( line ) ) {
 			startptr = wordin_findstartwrapper( str_cstr( line ), &type );
@@ -96,7 +101,7 @@ wordin_readf( FILE *fp, char *buf, int bufsize, int *bufpos, str *line, str *ref
 				str_strcatc( &tmp, startptr );
 				inref = 1;
 			}
-			endptr = wordin_findendwrapper( str_cstr( &tmp ), type );
+			endptr = wordin_findendwrapper( &tmp, type, &scanned );
 			if ( endptr ) {
 				str_segcpy( reference, str_cstr( &tmp ), endptr );
 				haveref = 1;
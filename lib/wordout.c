@@ -41,6 +41,8 @@ wordout_initparams( param *pm, const char *progname )
 	pm->nosplittitle     = 0;
 	pm->verbose          = 0;
 	pm->addcount         = 0;
+	pm->stream           = 0;
+	pm->nthreads         = 0;
 	pm->singlerefperfile = 0;
 
 	pm->headerf   = wordout_writeheader;
@@ -663,8 +665,6 @@ wordout_write( fields *info, FILE *outptr, param *p, unsigned long numrefs )
 	output_citeparts( info, outptr, -1, max, type );
 	fprintf( outptr, "</b:Source>\n" );
 
-	fflush( outptr );
-
 	return BIBL_OK;
 }
 
@@ -22,34 +22,89 @@ xml_init( xml *node )
 	str_init( &(node->value) );
 	slist_init( &(node->attributes) );
 	slist_init( &(node->attribute_values) );
-	node->down = NULL;
-	node->next = NULL;
+	node->down   = NULL;
+	node->next   = NULL;
+	node->blocks = NULL;
 }
 
+/* xml_block
+ *
+ * Nodes below the root passed to xml_parse() are handed out from blocks
+ * chained off the root, so a parse costs one allocation per block
+ * rather than per node, and xml_free() releases them all at once.
+ */
+#define XML_BLOCKSIZE (256)
+
+typedef struct xml_block {
+	struct xml_block *next;
+	int n;
+	xml node[ XML_BLOCKSIZE ];
+} xml_block;
+
 static xml *
-xml_new( void )
+xml_new( xml *root )
+{
+	xml_block *b = root->blocks;
+
+	if ( !b || b->n==XML_BLOCKSIZE ) {
+		b = ( xml_block * ) malloc( sizeof( xml_block ) );
+		if ( !b ) return NULL;
+		b->next = root->blocks;
+		b->n = 0;
+		root->blocks = b;
+	}
+
+	return &( b->node[ b->n++ ] );
+}
+
+static void
+xml_free_node( xml *node )
+{
+	str_free( &(node->tag) );
+	str_free( &(node->value) );
+	slist_free( &(node->attributes) );
+	slist_free( &(node->attribute_values) );
+}
+
+/* Free the contents of a chain of siblings and their descendants,
+ * iterating along the chain so long lists do not deepen the stack.
+ */
+static void
+xml_free_chain( xml *node )
 {
-	xml *node = ( xml * ) malloc( sizeof( xml ) );
-	if ( node ) xml_init( node );
-	return node;
+	while ( node ) {
+		xml_free_node( node );
+		if ( node->down ) xml_free_chain( node->down );
+		node = node->next;
+	}
 }
 
+/* Free everything below node, which must be the root of a parse,
+ * leaving node itself to be reused.
+ */
 static void
-xml_delete( xml *node )
+xml_free_down( xml *node )
 {
-	xml_free( node );
-	free( node );
+	xml_block *b, *next;
+
+	xml_free_chain( node->down );
+
+	for ( b=node->blocks; b; b=next ) {
+		next = b->next;
+		free( b );
+	}
+
+	node->down   = NULL;
+	node->blocks = NULL;
 }
 
 void
 xml_free( xml *node )
 {
-	str_free( &(node->tag) );
-	str_free( &(node->value) );
-	slist_free( &(node->attributes) );
-	slist_free( &(node->attribute_values) );
-	if ( node->down ) xml_delete( node->down );
-	if ( node->next ) xml_delete( node->next );
+	xml_free_node( node );
+	xml_free_chain( node->next );
+	xml_free_down( node );
+	node->next = NULL;
 }
 
 enum {
@@ -164,88 +219,103 @@ xml_processattrib( const char *p, xml *node, int *type )
 static const char *
 xml_processtag( const char *p, xml *node, int *type )
 {
-	str tag;
-
-	str_init( &tag );
+	const char *q;
 
 	if ( *p=='!' ) {
 		*type = XML_COMMENT;
 		while ( *p && *p!='>' ) p++;
 	}
-	else if ( *p=='?' ) {
-		*type = XML_DESCRIPTOR;
-		p++; /* skip '?' */
-		while ( *p && !strchr( " \t", *p ) && !xml_is_terminator(p,type) )
-			str_addchar( &tag, *p++ );
-		if ( *p==' ' || *p=='\t' )
-			p = xml_processattrib( p, node, type );
-	}
-	else if ( *p=='/' ) {
-		*type = XML_CLOSE;
-		while ( *p && !strchr( " \t", *p ) && !xml_is_terminator(p,type) )
-			str_addchar( &tag, *p++ );
-		if ( *p==' ' || *p=='\t' ) 
-			p = xml_processattrib( p, node, type );
-	}
 	else {
-		*type = XML_OPEN;
-		while ( *p && !strchr( " \t", *p ) && !xml_is_terminator(p,type) )
-			str_addchar( &tag, *p++ );
-		if ( *p==' ' || *p=='\t' ) 
+		if ( *p=='?' ) {
+			*type = XML_DESCRIPTOR;
+			p++; /* skip '?' */
+		}
+		else if ( *p=='/' ) *type = XML_CLOSE;
+		else *type = XML_OPEN;
+
+		q = p;
+		while ( *q && *q!=' ' && *q!='\t' && !xml_is_terminator(q,type) )
+			q++;
+		str_segcpy( &(node->tag), (char *) p, (char *) q );
+		p = q;
+
+		if ( *p==' ' || *p=='\t' )
 			p = xml_processattrib( p, node, type );
 	}
 	while ( *p && *p!='>' ) p++;
 	if ( *p=='>' ) p++;
 
-	str_strcpy( &(node->tag), &tag );
+	return p;
+}
 
-	str_free( &tag );
+/* Append the text up to the next tag to node's value; as with all
+ * values, leading white space is dropped except in <style> elements.
+ */
+static const char *
+xml_addtext( const char *p, xml *node, int is_style )
+{
+	const char *q;
 
-	return p;
+	if ( node->value.len==0 && !is_style )
+		while ( *p && *p!='<' && is_ws( *p ) ) p++;
+	q = p;
+	while ( *q && *q!='<' ) q++;
+	if ( q!=p ) str_segcat( &(node->value), (char *) p, (char *) q );
+
+	return q;
 }
 
-static void
-xml_appendnode( xml *onode, xml *nnode )
+/* retain white space for <style> tags in endnote xml */
+static int
+xml_is_style( xml *node )
 {
-	if ( !onode->down ) onode->down = nnode;
-	else {
-		xml *p = onode->down;
-		while ( p->next ) p = p->next;
-		p->next = nnode;
-	}
+	if ( str_cstr( &(node->tag) ) &&
+		!strcasecmp( str_cstr( &(node->tag) ),"style") ) return 1;
+	return 0;
 }
 
-const char *
-xml_parse( const char *p, xml *onode )
+/* xml_parse_children()
+ *
+ * Adds the text and children of onode, starting after its open tag and
+ * returning after its close tag.  New nodes come from root's blocks and
+ * are linked on at the tail of the chain.
+ */
+static const char *
+xml_parse_children( const char *p, xml *onode, xml *root )
 {
-	int type, is_style = 0;
-	xml *nnode;
+	xml *nnode, *tail, tmp;
+	int type, is_style;
 
-	while ( *p ) {
+	is_style = xml_is_style( onode );
 
-		/* retain white space for <style> tags in endnote xml */
-		if ( str_cstr( &(onode->tag) ) &&
-			!strcasecmp( str_cstr( &(onode->tag) ),"style") ) is_style=1;
+	tail = onode->down;
+	while ( tail && tail->next ) tail = tail->next;
 
-		while ( *p && *p!='<' ) {
-			if ( onode->value.len>0 || is_style || !is_ws( *p ) )
-				str_addchar( &(onode->value), *p );
-			p++;
-		}
+	while ( *p ) {
+
+		p = xml_addtext( p, onode, is_style );
 
 		if ( *p=='<' ) {
-			nnode = xml_new();
-			p = xml_processtag( p+1, nnode, &type );
+			xml_init( &tmp );
+			p = xml_processtag( p+1, &tmp, &type );
 			if ( type==XML_OPEN || type==XML_OPENCLOSE || type==XML_DESCRIPTOR ) {
-				xml_appendnode( onode, nnode );
+				nnode = xml_new( root );
+				if ( !nnode ) {
+					xml_free_node( &tmp );
+					goto out;
+				}
+				*nnode = tmp;
+				if ( tail ) tail->next = nnode;
+				else onode->down = nnode;
+				tail = nnode;
 				if ( type==XML_OPEN )
-					p = xml_parse( p, nnode );
+					p = xml_parse_children( p, nnode, root );
 			} else if ( type==XML_CLOSE ) {
 				/*check to see if it's closing for this one*/
-				xml_delete( nnode );
+				xml_free_node( &tmp );
 				goto out; /* assume it's right for now */
 			} else {
-				xml_delete( nnode );
+				xml_free_node( &tmp );
 			}
 		}
 
@@ -254,6 +324,92 @@ out:
 	return p;
 }
 
+const char *
+xml_parse( const char *p, xml *onode )
+{
+	return xml_parse_children( p, onode, onode );
+}
+
+/* xml_parse_events()
+ *
+ * Parses p as xml_parse() would, but hands each element to the
+ * callbacks in events rather than building a tree.  The nodes passed
+ * are reused for every element at the same depth, so a parse needs no
+ * allocations once the deepest element has been seen.  Elements still
+ * open at the end of the input are closed innermost first.
+ */
+int
+xml_parse_events( const char *p, xml_events *events )
+{
+	int type, depth = 0, max = 0, status = 0, i;
+	xml *stack = NULL, *node;
+
+	while ( *p ) {
+
+		/* ...text outside of all elements is dropped */
+		if ( depth ) p = xml_addtext( p, &(stack[depth-1]), xml_is_style( &(stack[depth-1]) ) );
+		else while ( *p && *p!='<' ) p++;
+		if ( *p!='<' ) break;
+
+		if ( depth==max ) {
+			node = ( xml * ) realloc( stack, sizeof( xml ) * ( max ? max*2 : 16 ) );
+			if ( !node ) {
+				status = XML_EVENTS_MEMERR;
+				goto out;
+			}
+			stack = node;
+			for ( i=max; i<( max ? max*2 : 16 ); ++i )
+				xml_init( &(stack[i]) );
+			max = ( max ? max*2 : 16 );
+		}
+
+		node = &(stack[depth]);
+		str_empty( &(node->tag) );
+		str_empty( &(node->value) );
+		slist_empty( &(node->attributes) );
+		slist_empty( &(node->attribute_values) );
+
+		p = xml_processtag( p+1, node, &type );
+
+		if ( type==XML_CLOSE ) {
+			if ( depth==0 ) break;
+			depth--;
+			status = events->end( &(stack[depth]), events->data );
+			if ( status ) goto out;
+		}
+
+		else if ( type==XML_OPEN || type==XML_OPENCLOSE || type==XML_DESCRIPTOR ) {
+			status = events->start( node, events->data );
+			if ( status==XML_EVENTS_EXPAND ) {
+				if ( type==XML_OPEN ) p = xml_parse_children( p, node, node );
+				status = events->end( node, events->data );
+				xml_free_down( node );
+				if ( status ) goto out;
+			}
+			else if ( status ) goto out;
+			else if ( type==XML_OPEN ) depth++;
+			else {
+				status = events->end( node, events->data );
+				if ( status ) goto out;
+			}
+		}
+
+	}
+
+	while ( depth ) {
+		depth--;
+		status = events->end( &(stack[depth]), events->data );
+		if ( status ) goto out;
+	}
+
+out:
+	for ( i=0; i<max; ++i )
+		xml_free( &(stack[i]) );
+	free( stack );
+
+	return status;
+}
+
 void
 xml_draw( xml *node, int n )
 {
@@ -318,6 +474,45 @@ xml_find_end( char *buffer, char *tag )
 	return p;
 }
 
+/* xml_find_start_more()
+ * xml_find_end_more()
+ *
+ * As xml_find_start() and xml_find_end(), but for a str that readers
+ * keep appending lines to while looking for the end of a record.
+ * *scanned holds where the previous call left off; only the newly
+ * added text (and enough of the old to catch a tag split across lines)
+ * is searched, so finding a record is linear in its length.
+ */
+char *
+xml_find_start_more( str *s, char *tag, unsigned long *scanned )
+{
+	unsigned long keep = strlen( tag ) + 1;
+	char *p;
+
+	if ( *scanned >= s->len ) return NULL;
+
+	p = xml_find_start( s->data + *scanned, tag );
+	if ( !p && s->len > *scanned + keep ) *scanned = s->len - keep;
+
+	return p;
+}
+
+char *
+xml_find_end_more( str *s, char *tag, unsigned long *scanned )
+{
+	unsigned long keep = strlen( tag ) + 2;
+	char *p;
+
+	if ( xml_pns ) keep += strlen( xml_pns ) + 1;
+
+	if ( *scanned >= s->len ) return NULL;
+
+	p = xml_find_end( s->data + *scanned, tag );
+	if ( !p && s->len > *scanned + keep ) *scanned = s->len - keep;
+
+	return p;
+}
+
 static int
 xml_tag_matches_simple( xml* node, const char *tag )
 {
@@ -412,8 +607,12 @@ xml_value( xml *node )
 	return &(node->value);
 }
 
+/* NULL for an element without text, also for the reused nodes passed by
+ * xml_parse_events() whose value may be allocated but empty
+ */
 char *
 xml_value_cstr( xml *node )
 {
+	if ( node->value.len==0 ) return NULL;
 	return str_cstr( &(node->value) );
 }
@@ -19,8 +19,27 @@ typedef struct xml {
 	slist attribute_values;
 	struct xml *down;
 	struct xml *next;
+	struct xml_block *blocks; /* nodes below a parsed root */
 } xml;
 
+/* xml_events
+ *
+ * Callbacks for xml_parse_events().  start() is called once an element's
+ * open tag has been read, with its tag and attributes set; end() once it
+ * is closed, with its own text in value.  If start() returns
+ * XML_EVENTS_EXPAND the element's children are parsed into node->down
+ * as by xml_parse() for end() to walk.  Any other non-zero return stops
+ * the parse and is returned by xml_parse_events().
+ */
+#define XML_EVENTS_EXPAND (1)
+#define XML_EVENTS_MEMERR (2)
+
+typedef struct xml_events {
+	int  (*start)( xml *node, void *data );
+	int  (*end)  ( xml *node, void *data );
+	void *data;
+} xml_events;
+
 void   xml_init                 ( xml *node );
 void   xml_free                 ( xml *node );
 int    xml_has_value            ( xml *node );
@@ -33,9 +52,12 @@ int    xml_tag_matches_has_value( xml *node, const char *tag );
 str *  xml_attribute            ( xml *node, const char *attribute );
 char * xml_find_start           ( char *buffer, char *tag );
 char * xml_find_end             ( char *buffer, char *tag );
+char * xml_find_start_more      ( str *s, char *tag, unsigned long *scanned );
+char * xml_find_end_more        ( str *s, char *tag, unsigned long *scanned );
 int    xml_tag_has_attribute    ( xml *node, const char *tag, const char *attribute, const char *attribute_value );
 int    xml_has_attribute        ( xml *node, const char *attribute, const char *attribute_value );
 const char * xml_parse                ( const char *p, xml *onode );
+int    xml_parse_events         ( const char *p, xml_events *events );
 
 extern char * xml_pns; /* global Namespace */
 
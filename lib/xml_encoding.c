@@ -10,68 +10,98 @@
 #include <stdlib.h>
 #include <string.h>
 #include "charsets.h"
+#include "is_ws.h"
 #include "str.h"
-#include "str_conv.h"
-#include "xml.h"
 #include "xml_encoding.h"
 
 static int
-xml_getencodingr( xml *node )
+xml_charset( const char *t )
 {
-	int n = CHARSET_UNKNOWN, m;
-	str *s;
-	char *t;
+	int n;
 
-	if ( xml_tag_matches( node, "xml" ) ) {
-		s = xml_attribute( node, "encoding" );
-		if ( str_has_value( s ) ) {
-			t = str_cstr( s );
-			if ( !strcasecmp( t, "UTF-8" ) )
-				n = CHARSET_UNICODE;
-			else if ( !strcasecmp( t, "UTF8" ) )
-				n = CHARSET_UNICODE;
-			else if ( !strcasecmp( t, "GB18030" ) )
-				n = CHARSET_GB18030;
-			else n = charset_find( t );
-			if ( n==CHARSET_UNKNOWN ) {
-				fprintf( stderr, "Warning: did not recognize encoding '%s'\n", t );
-			}
-		}
-	}
-        if ( node->down ) {
-		m = xml_getencodingr( node->down );
-		if ( m!=CHARSET_UNKNOWN ) n = m;
-	}
-        if ( node->next ) {
-		m = xml_getencodingr( node->next );
-		if ( m!=CHARSET_UNKNOWN ) n = m;
+	if ( !strcasecmp( t, "UTF-8" ) )
+		n = CHARSET_UNICODE;
+	else if ( !strcasecmp( t, "UTF8" ) )
+		n = CHARSET_UNICODE;
+	else if ( !strcasecmp( t, "GB18030" ) )
+		n = CHARSET_GB18030;
+	else n = charset_find( (char *) t );
+	if ( n==CHARSET_UNKNOWN ) {
+		fprintf( stderr, "Warning: did not recognize encoding '%s'\n", t );
 	}
 
 	return n;
 }
 
+static int
+xml_is_namechar( char c )
+{
+	if ( c>='a' && c<='z' ) return 1;
+	if ( c>='A' && c<='Z' ) return 1;
+	if ( c>='0' && c<='9' ) return 1;
+	if ( c=='_' || c=='-' || c=='.' || c==':' ) return 1;
+	return 0;
+}
+
+/* xml_getencoding()
+ *
+ * Return the character set named by the encoding pseudo-attribute of
+ * an XML declaration at the start of p, else CHARSET_UNICODE for a
+ * UTF-8 byte-order mark, else CHARSET_UNKNOWN.  Both can only begin a
+ * document, so readers call this once, on the first line of a stream.
+ *
+ *     <?xml version="1.0" encoding="UTF-8"?>
+ */
 int
-xml_getencoding( str *s )
+xml_getencoding( const char *p )
 {
-	int file_charset = CHARSET_UNKNOWN;
-	str descriptor;
-	xml descriptxml;
-	char *p, *q;
+	int n = CHARSET_UNKNOWN, bom = 0;
+	const char *name, *q;
+	char quote;
+	str value;
 
-	p = strstr( str_cstr( s ), "<?xml" );
-	if ( !p ) p = strstr( str_cstr( s ), "<?XML" );
-	if ( p ) {
-		q = strstr( p, "?>" );
-		if ( q ) {
-			str_init( &descriptor );
-			str_segcpy( &descriptor, p, q+2 );
-			xml_init( &descriptxml );
-			xml_parse( str_cstr( &descriptor ), &descriptxml );
-			file_charset = xml_getencodingr( &descriptxml );
-			xml_free( &descriptxml );
-			str_free( &descriptor );
-			str_segdel( s, p, q+2 );
+	if ( !p ) return CHARSET_UNKNOWN;
+
+	if ( (unsigned char)p[0]==0xEF &&
+	     (unsigned char)p[1]==0xBB &&
+	     (unsigned char)p[2]==0xBF ) {
+		bom = 1;
+		p += 3;
+	}
+
+	p = skip_ws( p );
+	if ( strncmp( p, "<?xml", 5 ) && strncmp( p, "<?XML", 5 ) ) {
+		if ( bom ) return CHARSET_UNICODE;
+		return CHARSET_UNKNOWN;
+	}
+	p += 5;
+
+	str_init( &value );
+
+	while ( *p ) {
+		p = skip_ws( p );
+		if ( *p=='?' || !xml_is_namechar( *p ) ) break;
+		name = p;
+		while ( xml_is_namechar( *p ) ) p++;
+		q = p;
+		p = skip_ws( p );
+		if ( *p!='=' ) break;
+		p = skip_ws( p+1 );
+		if ( *p!='\"' && *p!='\'' ) break;
+		quote = *p++;
+		str_empty( &value );
+		while ( *p && *p!=quote ) str_addchar( &value, *p++ );
+		if ( *p!=quote ) break;
+		p++;
+		if ( q-name==8 && !strncmp( name, "encoding", 8 ) ) {
+			if ( str_has_value( &value ) ) n = xml_charset( str_cstr( &value ) );
+			break;
 		}
 	}
-	return file_charset;
+
+	str_free( &value );
+
+	if ( n==CHARSET_UNKNOWN && bom ) n = CHARSET_UNICODE;
+
+	return n;
 }
@@ -9,6 +9,6 @@
 #ifndef XML_GETENCODING_H
 #define XML_GETENCODING_H
 
-int xml_getencoding( str *s );
+int xml_getencoding( const char *p );
 
 #endif
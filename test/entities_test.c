@@ -111,6 +111,46 @@ test_hex_entities( void )
 	return failed;
 }
 
+int
+test_html_entities( void )
+{
+	struct {
+		char *in;
+		unsigned int answer;
+		int err;
+		unsigned int pos;
+	} tests[] = {
+		{ "&amp;*",      38, 0, 5 },
+		{ "&AMP;*",      38, 0, 5 },
+		{ "&Agrave;*",  192, 0, 8 },
+		{ "&agrave;*",  192, 0, 8 },  /* case-independent, first entry wins */
+		{ "&divide;*",  247, 0, 8 },
+		{ "&thetasym;*", 977, 0, 10 },
+		{ "&amp*",      '&', 1, 1 },
+		{ "&ampx;*",    '&', 1, 1 },
+		{ "&;*",        '&', 1, 1 },
+		{ "&",          '&', 1, 1 },
+		{ "&abcdefghijklmnopqrstuvwxyz;*", '&', 1, 1 },
+	};
+	int ntests = sizeof( tests ) / sizeof( tests[0] );
+	int i, failed = 0, err, unicode;
+	unsigned int answer, pos_in;
+
+	for ( i=0; i<ntests; ++i ) {
+		pos_in = 0;
+		err = 0;
+		answer = decode_entity( tests[i].in, &pos_in, &unicode, &err );
+		if ( answer!=tests[i].answer || err!=tests[i].err || pos_in!=tests[i].pos ) {
+			failed = 1;
+			printf("%s: Error test_html_entities sent '%s', "
+				"returned %u err %d pos %u, expected %u err %d pos %u\n",
+				progname, tests[i].in, answer, err, pos_in,
+				tests[i].answer, tests[i].err, tests[i].pos );
+		}
+	}
+	return failed;
+}
+
 int
 main( int argc, char *argv[] )
 {
@@ -118,6 +158,7 @@ main( int argc, char *argv[] )
 	failed += test_decimal_entities1();
 	failed += test_decimal_entities2();
 	failed += test_hex_entities();
+	failed += test_html_entities();
 	if ( !failed ) {
 		printf( "%s: PASSED\n", progname );
 		return EXIT_SUCCESS;
@@ -0,0 +1,99 @@
+/*
+ * gb18030_test.c
+ *
+ * Copyright (c) agent 2026
+ *
+ * Source code released under the GPL version 2
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gb18030.h"
+
+char progname[] = "gb18030_test";
+char version[] = "0.1";
+
+/*
+ * Every Unicode code point outside the surrogate area should encode
+ * and decode back to itself.
+ */
+int
+test_roundtrip( void )
+{
+	unsigned int i, answer, pos;
+	unsigned char out[4];
+	int failed = 0, n;
+	char buf[8];
+
+	for ( i=0; i<=0x10FFFF; ++i ) {
+		if ( i>=0xD800 && i<=0xDFFF ) continue;
+		n = gb18030_encode( i, out );
+		if ( n<1 || n>4 ) {
+			failed = 1;
+			printf( "%s: Error test_roundtrip U+%04X encoded to %d bytes\n",
+				progname, i, n );
+			continue;
+		}
+		memset( buf, 0, sizeof( buf ) );
+		memcpy( buf, out, n );
+		pos = 0;
+		answer = gb18030_decode( buf, &pos );
+		if ( answer!=i || pos!=(unsigned int) n ) {
+			failed = 1;
+			printf( "%s: Error test_roundtrip U+%04X decoded to U+%04X "
+				"using %u of %d bytes\n", progname, i, answer, pos, n );
+		}
+	}
+	return failed;
+}
+
+/*
+ * Spot check four-byte sequences at the ends of the linear ranges
+ */
+int
+test_four_byte_ranges( void )
+{
+	struct {
+		char bytes[5];
+		unsigned int unicode;
+	} tests[] = {
+		{ "\x81\x30\xD3\x30", 0x0452 },
+		{ "\x81\x36\xA5\x31", 0x200F },
+		{ "\x82\x35\x8F\x33", 0x9FA6 },
+		{ "\x83\x36\xC7\x38", 0xD7FF },
+		{ "\x84\x31\xA4\x39", 0xFFFF },
+		{ "\x90\x30\x81\x30", 0x10000 },
+		{ "\xE3\x32\x9A\x35", 0x10FFFF },
+		{ "\x84\x31\xA5\x30", '?' },      /* unassigned */
+	};
+	int ntests = sizeof( tests ) / sizeof( tests[0] );
+	unsigned int answer, pos;
+	int i, failed = 0;
+
+	for ( i=0; i<ntests; ++i ) {
+		pos = 0;
+		answer = gb18030_decode( tests[i].bytes, &pos );
+		if ( answer!=tests[i].unicode || pos!=4 ) {
+			failed = 1;
+			printf( "%s: Error test_four_byte_ranges test %d decoded to "
+				"U+%04X, expected U+%04X\n", progname, i, answer,
+				tests[i].unicode );
+		}
+	}
+	return failed;
+}
+
+int
+main( int argc, char *argv[] )
+{
+	int failed = 0;
+	failed += test_roundtrip();
+	failed += test_four_byte_ranges();
+	if ( !failed ) {
+		printf( "%s: PASSED\n", progname );
+		return EXIT_SUCCESS;
+	} else {
+		printf( "%s: FAILED\n", progname );
+		return EXIT_FAILURE;
+	}
+}
@@ -0,0 +1,111 @@
+/*
+ * modsin_test.c
+ *
+ * Copyright (c) agent 2026
+ *
+ * Source code released under the GPL version 2
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bibutils.h"
+
+char progname[] = "modsin_test";
+
+/* Each input holds two records titled "One" and "Two".  A plain <mods>
+ * seen before the first <mods:mods>, here in a comment, must not stop
+ * the namespaced records from being found.
+ */
+int
+test_record_boundaries( void )
+{
+	struct {
+		char *name;
+		char *input;
+	} tests[] = {
+		{ "plain",
+		  "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		  "<modsCollection>\n"
+		  "<mods><titleInfo><title>One</title></titleInfo></mods>\n"
+		  "<mods ID=\"b\">\n<titleInfo><title>Two</title></titleInfo>\n</mods>\n"
+		  "</modsCollection>\n" },
+		{ "namespaced",
+		  "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		  "<mods:modsCollection xmlns:mods=\"http://www.loc.gov/mods/v3\">\n"
+		  "<mods:mods><mods:titleInfo><mods:title>One</mods:title></mods:titleInfo></mods:mods>\n"
+		  "<mods:mods ID=\"b\">\n<mods:titleInfo><mods:title>Two</mods:title></mods:titleInfo>\n</mods:mods>\n"
+		  "</mods:modsCollection>\n" },
+		{ "namespaced after comment",
+		  "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		  "<!-- each record is a <mods> element -->\n"
+		  "<mods:modsCollection xmlns:mods=\"http://www.loc.gov/mods/v3\">\n"
+		  "<mods:mods ID=\"a\">\n<mods:titleInfo><mods:title>One</mods:title></mods:titleInfo>\n</mods:mods>\n"
+		  "<mods:mods ID=\"b\">\n<mods:titleInfo><mods:title>Two</mods:title></mods:titleInfo>\n</mods:mods>\n"
+		  "</mods:modsCollection>\n" },
+	};
+	int ntests = sizeof( tests ) / sizeof( tests[0] );
+	char *titles[] = { "One", "Two" };
+	int failed = 0;
+	int i, j, status;
+	char *title;
+	param p;
+	bibl b;
+	FILE *fp;
+
+	for ( i=0; i<ntests; ++i ) {
+
+		status = bibl_initparams( &p, BIBL_MODSIN, BIBL_MODSOUT, progname );
+		if ( status!=BIBL_OK ) {
+			printf( "%s: Error %s bibl_initparams() returned %d\n", progname, tests[i].name, status );
+			failed = 1;
+			continue;
+		}
+
+		fp = tmpfile();
+		if ( !fp ) {
+			printf( "%s: Error cannot open temporary file\n", progname );
+			bibl_freeparams( &p );
+			return 1;
+		}
+		fputs( tests[i].input, fp );
+		rewind( fp );
+
+		bibl_init( &b );
+		status = bibl_read( &b, fp, "tmpfile", &p );
+		if ( status!=BIBL_OK || b.n!=2 ) {
+			printf( "%s: Error %s read returned %d with %ld references, expected 2\n",
+				progname, tests[i].name, status, b.n );
+			failed = 1;
+		} else {
+			for ( j=0; j<2; ++j ) {
+				title = fields_findv( b.ref[j], LEVEL_ANY, FIELDS_CHRP, "TITLE" );
+				if ( !title || strcmp( title, titles[j] ) ) {
+					printf( "%s: Error %s reference %d title '%s', expected '%s'\n",
+						progname, tests[i].name, j, title ? title : "(null)", titles[j] );
+					failed = 1;
+				}
+			}
+		}
+
+		bibl_free( &b );
+		fclose( fp );
+		bibl_freeparams( &p );
+	}
+
+	return failed;
+}
+
+int
+main( int argc, char *argv[] )
+{
+	int failed = 0;
+	failed += test_record_boundaries();
+	if ( !failed ) {
+		printf( "%s: PASSED\n", progname );
+		return EXIT_SUCCESS;
+	} else {
+		printf( "%s: FAILED\n", progname );
+		return EXIT_FAILURE;
+	}
+}
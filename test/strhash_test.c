@@ -0,0 +1,196 @@
+/*
+ * strhash_test.c
+ *
+ * Copyright (c) agent 2026
+ *
+ * Source code released under the GPL version 2
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "strhash.h"
+
+char progname[] = "strhash_test";
+char version[] = "0.1";
+
+#define check( a, b ) { \
+	if ( !(a) ) { \
+		fprintf( stderr, "Failed %s (%s) in %s() line %d\n", #a, b, __FUNCTION__, __LINE__ );\
+		return 1; \
+	} \
+}
+
+/*
+ * void strhash_init( strhash *h, int mode );
+ */
+int
+test_init( void )
+{
+	strhash h;
+
+	strhash_init( &h, STRHASH_CASE );
+	check( (strhash_num( &h )==0), "new strhash should be empty" );
+	check( (strhash_find( &h, "key" )==STRHASH_NOTFOUND), "empty strhash should find nothing" );
+	strhash_free( &h );
+
+	return 0;
+}
+
+/*
+ * int strhash_add( strhash *h, const char *key, int *n );
+ */
+int
+test_add( void )
+{
+	int n, status;
+	strhash h;
+
+	strhash_init( &h, STRHASH_CASE );
+
+	status = strhash_add( &h, "first", &n );
+	check( (status==STRHASH_OK), "strhash_add() should return STRHASH_OK" );
+	check( (n==0), "first key should be at position 0" );
+
+	status = strhash_add( &h, "second", &n );
+	check( (status==STRHASH_OK), "strhash_add() should return STRHASH_OK" );
+	check( (n==1), "second key should be at position 1" );
+
+	status = strhash_add( &h, "first", &n );
+	check( (status==STRHASH_OK), "strhash_add() should return STRHASH_OK" );
+	check( (n==0), "re-adding key should return original position" );
+	check( (strhash_num( &h )==2), "re-adding key should not add it again" );
+
+	status = strhash_add( &h, "", &n );
+	check( (status==STRHASH_OK), "strhash_add() should return STRHASH_OK" );
+	check( (n==2), "empty key should be allowed" );
+
+	check( (!strcmp( strhash_key( &h, 1 ), "second" )), "strhash_key() should return key" );
+
+	strhash_free( &h );
+
+	return 0;
+}
+
+/*
+ * int strhash_find( strhash *h, const char *key );
+ */
+#define COUNT (10000)
+int
+test_find( void )
+{
+	int i, n, status;
+	char buf[64];
+	strhash h;
+
+	strhash_init( &h, STRHASH_CASE );
+
+	for ( i=0; i<COUNT; ++i ) {
+		sprintf( buf, "key%d", i );
+		status = strhash_add( &h, buf, &n );
+		check( (status==STRHASH_OK), "strhash_add() should return STRHASH_OK" );
+		check( (n==i), "keys should be numbered in order added" );
+	}
+
+	for ( i=0; i<COUNT; ++i ) {
+		sprintf( buf, "key%d", i );
+		check( (strhash_find( &h, buf )==i), "added key should be found" );
+	}
+
+	check( (strhash_find( &h, "KEY1" )==STRHASH_NOTFOUND), "STRHASH_CASE should be case sensitive" );
+	check( (strhash_find( &h, "key" )==STRHASH_NOTFOUND), "missing key should not be found" );
+
+	strhash_free( &h );
+
+	return 0;
+}
+
+int
+test_nocase( void )
+{
+	int n, status;
+	strhash h;
+
+	strhash_init( &h, STRHASH_NOCASE );
+
+	status = strhash_add( &h, "Journal", &n );
+	check( (status==STRHASH_OK), "strhash_add() should return STRHASH_OK" );
+	check( (strhash_find( &h, "JOURNAL" )==0), "STRHASH_NOCASE should ignore case" );
+	check( (strhash_find( &h, "journal" )==0), "STRHASH_NOCASE should ignore case" );
+
+	status = strhash_add( &h, "jOuRnAl", &n );
+	check( (n==0), "STRHASH_NOCASE should treat keys differing in case as equal" );
+	check( (!strcmp( strhash_key( &h, 0 ), "Journal" )), "first spelling of key should be kept" );
+
+	strhash_free( &h );
+
+	return 0;
+}
+
+/*
+ * void strhash_empty( strhash *h );
+ */
+int
+test_empty( void )
+{
+	int n;
+	strhash h;
+
+	strhash_init( &h, STRHASH_CASE );
+	strhash_add( &h, "one", &n );
+	strhash_add( &h, "two", &n );
+
+	strhash_empty( &h );
+	check( (strhash_num( &h )==0), "strhash_empty() should remove all keys" );
+	check( (strhash_find( &h, "one" )==STRHASH_NOTFOUND), "strhash_empty() should remove all keys" );
+
+	strhash_add( &h, "two", &n );
+	check( (n==0), "keys should be renumbered after strhash_empty()" );
+
+	strhash_free( &h );
+
+	return 0;
+}
+
+/*
+ * unsigned int strhash_hash( const char *key, int mode );
+ * unsigned int strhash_hashn( const char *key, int len, int mode );
+ */
+int
+test_hash( void )
+{
+	/* FNV-1a reference values */
+	check( (strhash_hash( "", STRHASH_CASE )==2166136261U), "empty key should hash to the offset basis" );
+	check( (strhash_hash( "a", STRHASH_CASE )==0xe40c292cU), "hash of \"a\" should match FNV-1a" );
+
+	check( (strhash_hash( "Journal", STRHASH_CASE )!=strhash_hash( "JOURNAL", STRHASH_CASE )), "case-sensitive hash should differ by case" );
+	check( (strhash_hash( "Journal", STRHASH_NOCASE )==strhash_hash( "JOURNAL", STRHASH_NOCASE )), "case-folded hash should ignore case" );
+
+	check( (strhash_hashn( "Journal of", 7, STRHASH_CASE )==strhash_hash( "Journal", STRHASH_CASE )), "strhash_hashn() should stop after len bytes" );
+	check( (strhash_hashn( "amp;", 3, STRHASH_NOCASE )==strhash_hash( "AMP", STRHASH_NOCASE )), "strhash_hashn() should fold case" );
+	check( (strhash_hashn( "key", -1, STRHASH_CASE )==strhash_hash( "key", STRHASH_CASE )), "negative len should hash to the terminator" );
+
+	return 0;
+}
+
+int
+main( int argc, char *argv[] )
+{
+	int failed = 0;
+
+	failed += test_init();
+	failed += test_add();
+	failed += test_find();
+	failed += test_nocase();
+	failed += test_empty();
+	failed += test_hash();
+
+	if ( !failed ) {
+		printf( "%s: PASSED\n", progname );
+		return EXIT_SUCCESS;
+	} else {
+		printf( "%s: FAILED\n", progname );
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,110 @@
+/*
+ * strsearch_test.c
+ *
+ * Copyright (c) agent 2026
+ *
+ * Source code released under the GPL version 2
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "strsearch.h"
+
+char progname[] = "strsearch_test";
+char version[] = "0.1";
+
+#define check( a, b ) { \
+	if ( !(a) ) { \
+		fprintf( stderr, "Failed %s (%s) in %s() line %d\n", #a, b, __FUNCTION__, __LINE__ );\
+		return 1; \
+	} \
+}
+
+/* reference implementation to compare against */
+static char *
+naive_search( const char *haystack, const char *needle )
+{
+	unsigned long i;
+
+	if ( !(*needle) ) return (char *) haystack;
+
+	while ( *haystack ) {
+		for ( i=0; needle[i] && haystack[i]; ++i )
+			if ( toupper((unsigned char)haystack[i]) != toupper((unsigned char)needle[i]) ) break;
+		if ( !needle[i] ) return (char *) haystack;
+		haystack++;
+	}
+
+	return NULL;
+}
+
+/*
+ * char *strsearch( const char *haystack, const char *needle );
+ */
+int
+test_basic( void )
+{
+	const char *s = "The quick <MODS ID=1>brown</mods> fox";
+
+	check( (strsearch( s, "" )==s), "empty needle should return haystack" );
+	check( (strsearch( "", "a" )==NULL), "empty haystack should find nothing" );
+	check( (strsearch( s, "<mods " )==s+10), "case-independent match" );
+	check( (strsearch( s, "</MODS>" )==s+26), "case-independent match" );
+	check( (strsearch( s, "the" )==s), "match at start of haystack" );
+	check( (strsearch( s, "FOX" )==s+34), "match at end of haystack" );
+	check( (strsearch( s, "foxes" )==NULL), "needle running past end of haystack" );
+	check( (strsearch( s, "<mods>" )==NULL), "no match" );
+	check( (strsearch( "aaab", "aab" )!=NULL), "match after partial match" );
+
+	return 0;
+}
+
+/*
+ * Exercise every alignment of haystack and match position so that
+ * block-at-a-time scanning is compared across block boundaries.
+ */
+int
+test_alignment( void )
+{
+	const char *needles[] = { "<", "</mods>", "<MoDs ", "xyz", "ab", "\xe9t\xe9" };
+	int nneedles = sizeof( needles ) / sizeof( needles[0] );
+	char buf[128], *h;
+	int start, pos, i, len;
+
+	for ( i=0; i<nneedles; ++i ) {
+		len = strlen( needles[i] );
+		for ( start=0; start<32; ++start ) {
+			for ( pos=start; pos+len<80; ++pos ) {
+				memset( buf, 'a', sizeof( buf ) );
+				memcpy( buf+pos, needles[i], len );
+				buf[80] = '\0';
+				h = buf + start;
+				check( (strsearch( h, needles[i] )==naive_search( h, needles[i] )), needles[i] );
+				buf[pos+len-1] = '\0';
+				check( (strsearch( h, needles[i] )==naive_search( h, needles[i] )), needles[i] );
+			}
+		}
+	}
+
+	return 0;
+}
+
+int
+main( int argc, char *argv[] )
+{
+	int failed = 0;
+
+	failed += test_basic();
+	failed += test_alignment();
+
+	if ( !failed ) {
+		printf( "%s: PASSED\n", progname );
+		return EXIT_SUCCESS;
+	} else {
+		printf( "%s: FAILED\n", progname );
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -8,6 +8,7 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "utf8.h"
 
 char progname[] = "utf8_test";
@@ -42,11 +43,127 @@ test_utf8( void )
 }
 
 
+int
+test_utf8_valid( void )
+{
+	struct {
+		char *s;
+		int len;
+	} tests[] = {
+		{ "a",                                 1 },
+		{ "\xc3\xa9",                          2 },
+		{ "\xe2\x80\x94",                      3 },
+		{ "\xf0\x9f\x98\x80",                  4 },
+		{ "\xf8\x88\x80\x80\x80",              5 },
+		{ "\xfc\x84\x80\x80\x80\x80",          6 },
+		{ "\xc3",                              0 },  /* truncated */
+		{ "\xc3(",                             0 },  /* bad continuation */
+		{ "\xe2\x80(",                         0 },
+		{ "\xa9",                              0 },  /* lone continuation */
+		{ "\xc0\x80",                          0 },  /* overlong */
+		{ "\xe0\x80\xaf",                      0 },
+		{ "\xff",                              0 },
+	};
+	unsigned int ntests = sizeof( tests ) / sizeof( tests[0] );
+	unsigned char ubuf[6];
+	char buf[64];
+	unsigned int i;
+	int n, nc, failed = 0;
+
+	for ( i=0; i<ntests; ++i ) {
+		n = utf8_char_valid( tests[i].s, strlen( tests[i].s ) );
+		if ( n!=tests[i].len ) {
+			printf( "%s: Error test_utf8_valid test %u returned %d, "
+				"expected %d\n", progname, i, n, tests[i].len );
+			failed = 1;
+		}
+	}
+
+	/* everything utf8_encode() produces is valid */
+	for ( i=0; i<1000000; ++i ) {
+		nc = utf8_encode( i, ubuf );
+		if ( utf8_char_valid( (char *) ubuf, nc )!=nc ) {
+			printf( "%s: Error test_utf8_valid encoding of %u "
+				"not valid\n", progname, i );
+			failed = 1;
+		}
+	}
+
+	/* spans stop at the first non-ASCII or invalid byte */
+	for ( i=0; i<40; ++i ) {
+		memset( buf, 'a', sizeof( buf ) );
+		buf[i] = (char) 0xc3;
+		buf[i+1] = (char) 0xa9;
+		buf[50] = (char) 0xa9;
+		if ( utf8_ascii_span( buf, 60 )!=i ) {
+			printf( "%s: Error test_utf8_valid ascii span %lu, "
+				"expected %u\n", progname, utf8_ascii_span( buf, 60 ), i );
+			failed = 1;
+		}
+		if ( utf8_valid_span( buf, 60 )!=50 ) {
+			printf( "%s: Error test_utf8_valid valid span %lu, "
+				"expected 50\n", progname, utf8_valid_span( buf, 60 ) );
+			failed = 1;
+		}
+	}
+
+	return failed;
+}
+
+/* utf8_valid_span() must agree with utf8_char_valid() applied a
+ * character at a time, whatever the mix of characters and wherever
+ * they fall relative to sixteen-byte blocks.
+ */
+int
+test_utf8_valid_span( void )
+{
+	char *pieces[] = {
+		"a", "<", "\xc3\xa9", "\xd0\x96", "\xe2\x80\x94", "\xe4\xb8\xad",
+		"\xed\xa0\x80", "\xf0\x9f\x98\x80", "\xf4\x90\x80\x80",
+		"\xf8\x88\x80\x80\x80", "\xfc\x84\x80\x80\x80\x80",
+		"\xc0\x80", "\xc1\xbf", "\xe0\x9f\xbf", "\xf0\x8f\xbf\xbf",
+		"\xa9", "\xc3", "\xe2\x80", "\xf0\x9f\x98", "\xff",
+	};
+	int npieces = sizeof( pieces ) / sizeof( pieces[0] );
+	unsigned long len, n, expected;
+	char buf[256];
+	int i, k, nc, failed = 0;
+
+	srand( 1 );
+	for ( i=0; i<20000 && !failed; ++i ) {
+		len = 0;
+		while ( len < 160 ) {
+			/* mostly valid characters so spans get long */
+			k = rand() % ( ( rand() % 64 ) ? 11 : npieces );
+			strcpy( &(buf[len]), pieces[k] );
+			len += strlen( pieces[k] );
+		}
+		len -= rand() % 8;
+
+		/* start at each offset into the first block */
+		for ( k=0; k<17; ++k ) {
+			expected = k;
+			while ( expected < len && ( nc = utf8_char_valid( &(buf[expected]), len-expected ) ) )
+				expected += nc;
+			n = utf8_valid_span( &(buf[k]), len-k );
+			if ( n!=expected-k ) {
+				printf( "%s: Error test_utf8_valid_span offset %d returned %lu, "
+					"expected %lu\n", progname, k, n, expected-k );
+				failed = 1;
+			}
+		}
+	}
+
+	return failed;
+}
+
 int
 main( int argc, char *argv[] )
 {
 	int failed = 0;
 	failed += test_utf8();
+	failed += test_utf8_valid();
+	failed += test_utf8_valid_span();
 	if ( !failed ) {
 		printf( "%s: PASSED\n", progname );
 		return EXIT_SUCCESS;
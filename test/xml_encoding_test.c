@@ -0,0 +1,130 @@
+/*
+ * xml_encoding_test.c
+ *
+ * Copyright (c) agent 2026
+ *
+ * Source code released under the GPL version 2
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bibutils.h"
+#include "xml_encoding.h"
+
+char progname[] = "xml_encoding_test";
+
+int
+test_getencoding( void )
+{
+	struct {
+		char *s;
+		char *charset;  /* NULL for CHARSET_UNKNOWN */
+	} tests[] = {
+		{ "<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>", "ISO-8859-1" },
+		{ "<?xml version=\"1.0\" encoding='UTF-8'?>",        "UTF-8"      },
+		{ "\xef\xbb\xbf<?xml version=\"1.0\"?>",              "UTF-8"      },
+		{ "<?xml version=\"1.0\"?>",                          NULL         },
+		{ "<mods>",                                           NULL         },
+		{ "",                                                 NULL         },
+	};
+	int ntests = sizeof( tests ) / sizeof( tests[0] );
+	int failed = 0;
+	int i, n, expected;
+
+	for ( i=0; i<ntests; ++i ) {
+		if ( !tests[i].charset ) expected = CHARSET_UNKNOWN;
+		else if ( !strcmp( tests[i].charset, "UTF-8" ) ) expected = CHARSET_UNICODE;
+		else expected = charset_find( tests[i].charset );
+		n = xml_getencoding( tests[i].s );
+		if ( n!=expected ) {
+			printf( "%s: Error xml_getencoding( '%s' ) returned %d, expected %d\n",
+				progname, tests[i].s, n, expected );
+			failed = 1;
+		}
+	}
+
+	return failed;
+}
+
+/* The encoding declaration must be found even when blank or
+ * whitespace-only lines come before it.
+ */
+int
+test_leading_blank_lines( void )
+{
+	struct {
+		int mode;
+		char *name;
+		char *ref;
+	} tests[] = {
+		{ BIBL_MEDLINEIN,    "medin",    "<PubmedArticle><MedlineCitation><Article><ArticleTitle>Caf\xe9</ArticleTitle></Article></MedlineCitation></PubmedArticle>\n" },
+		{ BIBL_MODSIN,       "modsin",   "<modsCollection><mods><titleInfo><title>Caf\xe9</title></titleInfo></mods></modsCollection>\n" },
+		{ BIBL_WORDIN,       "wordin",   "<b:Sources><b:Source><b:Title>Caf\xe9</b:Title></b:Source></b:Sources>\n" },
+		{ BIBL_EBIIN,        "ebiin",    "<Publication><Article><ArticleTitle>Caf\xe9</ArticleTitle></Article></Publication>\n" },
+		{ BIBL_ENDNOTEXMLIN, "endxmlin", "<xml><records><record><ref-type name=\"Journal Article\">17</ref-type><titles><title><style>Caf\xe9</style></title></titles></record>\n</records>\n</xml>\n" },
+	};
+	int ntests = sizeof( tests ) / sizeof( tests[0] );
+	int failed = 0;
+	int i, status;
+	char *title;
+	param p;
+	bibl b;
+	FILE *fp;
+
+	for ( i=0; i<ntests; ++i ) {
+
+		status = bibl_initparams( &p, tests[i].mode, BIBL_MODSOUT, progname );
+		if ( status!=BIBL_OK ) {
+			printf( "%s: Error %s bibl_initparams() returned %d\n", progname, tests[i].name, status );
+			failed = 1;
+			continue;
+		}
+
+		fp = tmpfile();
+		if ( !fp ) {
+			printf( "%s: Error cannot open temporary file\n", progname );
+			bibl_freeparams( &p );
+			return 1;
+		}
+		fputs( "\n  \n\t\n<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>\n", fp );
+		fputs( tests[i].ref, fp );
+		rewind( fp );
+
+		bibl_init( &b );
+		status = bibl_read( &b, fp, "tmpfile", &p );
+		if ( status!=BIBL_OK || b.n!=1 ) {
+			printf( "%s: Error %s read returned %d with %ld references, expected 1\n",
+				progname, tests[i].name, status, b.n );
+			failed = 1;
+		} else {
+			title = fields_findv( b.ref[0], LEVEL_ANY, FIELDS_CHRP, "TITLE" );
+			if ( !title || strcmp( title, "Caf\xc3\xa9" ) ) {
+				printf( "%s: Error %s title '%s', expected 'Caf\xc3\xa9'\n",
+					progname, tests[i].name, title ? title : "(null)" );
+				failed = 1;
+			}
+		}
+
+		bibl_free( &b );
+		fclose( fp );
+		bibl_freeparams( &p );
+	}
+
+	return failed;
+}
+
+int
+main( int argc, char *argv[] )
+{
+	int failed = 0;
+	failed += test_getencoding();
+	failed += test_leading_blank_lines();
+	if ( !failed ) {
+		printf( "%s: PASSED\n", progname );
+		return EXIT_SUCCESS;
+	} else {
+		printf( "%s: FAILED\n", progname );
+		return EXIT_FAILURE;
+	}
+}